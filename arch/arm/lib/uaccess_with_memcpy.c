@@ -269,7 +269,7 @@ arm_copy_from_user(void *to, const void __user *from, unsigned long n)
 	 * With frame pointer disabled, tail call optimization kicks in
 	 * as well making this test almost invisible.
 	 */
-	if (n < COPY_TO_USER_THRESHOLD) {
+	if (n < COPY_FROM_USER_THRESHOLD) {
 		unsigned long ua_flags = uaccess_save_and_enable();
 		n = __copy_from_user_std(to, from, n);
 		uaccess_restore(ua_flags);
@@ -88,6 +88,7 @@ static DEFINE_MUTEX(loop_ctl_mutex);
 
 static int max_part;
 static int part_shift;
+static bool default_dio;
 
 static int transfer_xor(struct loop_device *lo, int cmd,
 			struct page *raw_page, unsigned raw_off,
@@ -1162,7 +1163,9 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 	blk_queue_io_min(lo->lo_queue, bsize);
 
 	loop_update_rotational(lo);
-	loop_update_dio(lo);
+	/* default_dio only asks; unaligned setups stay on buffered I/O */
+	__loop_update_dio(lo, (file->f_flags & O_DIRECT) || lo->use_dio ||
+			  default_dio);
 	loop_sysfs_init(lo);
 
 	size = get_loop_size(lo, file);
@@ -1957,6 +1960,8 @@ module_param(max_loop, int, 0444);
 MODULE_PARM_DESC(max_loop, "Maximum number of loop devices");
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "Maximum number of partitions per loop device");
+module_param(default_dio, bool, 0644);
+MODULE_PARM_DESC(default_dio, "Use direct I/O on the backing file by default when alignment allows");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
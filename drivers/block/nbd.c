@@ -517,6 +517,47 @@ static int sock_xmit(struct nbd_device *nbd, int index, int send,
 	return result;
 }
 
+/*
+ * Send one page of write payload.  Hand the page to the socket instead of
+ * copying it into the skb when that is safe; the socket holds its own page
+ * reference until the data is acked.
+ */
+static int sock_send_bvec(struct nbd_device *nbd, int index,
+			  struct bio_vec *bvec, int msg_flags, int *sent)
+{
+	struct socket *sock = nbd->config->socks[index]->sock;
+	unsigned int offset = bvec->bv_offset;
+	size_t len = bvec->bv_len;
+	unsigned int noreclaim_flag;
+	struct iov_iter from;
+	int result;
+
+	if (unlikely(!sock) || !sendpage_ok(bvec->bv_page)) {
+		iov_iter_bvec(&from, WRITE, bvec, 1, bvec->bv_len);
+		return sock_xmit(nbd, index, 1, &from, msg_flags, sent);
+	}
+
+	noreclaim_flag = memalloc_noreclaim_save();
+	do {
+		sock->sk->sk_allocation = GFP_NOIO | __GFP_MEMALLOC;
+		result = kernel_sendpage(sock, bvec->bv_page, offset, len,
+					 msg_flags | MSG_NOSIGNAL);
+		if (result <= 0) {
+			if (result == 0)
+				result = -EPIPE;
+			break;
+		}
+		if (sent)
+			*sent += result;
+		offset += result;
+		len -= result;
+	} while (len);
+
+	memalloc_noreclaim_restore(noreclaim_flag);
+
+	return result;
+}
+
 /*
  * Different settings for sk->sk_sndtimeo can result in different return values
  * if there is a signal pending when we enter sendmsg, because reasons?
@@ -629,16 +670,16 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 
 			dev_dbg(nbd_to_dev(nbd), "request %p: sending %d bytes data\n",
 				req, bvec.bv_len);
-			iov_iter_bvec(&from, WRITE, &bvec, 1, bvec.bv_len);
 			if (skip) {
-				if (skip >= iov_iter_count(&from)) {
-					skip -= iov_iter_count(&from);
+				if (skip >= bvec.bv_len) {
+					skip -= bvec.bv_len;
 					continue;
 				}
-				iov_iter_advance(&from, skip);
+				bvec.bv_offset += skip;
+				bvec.bv_len -= skip;
 				skip = 0;
 			}
-			result = sock_xmit(nbd, index, 1, &from, flags, &sent);
+			result = sock_send_bvec(nbd, index, &bvec, flags, &sent);
 			if (result <= 0) {
 				if (was_interrupted(result)) {
 					/* We've already sent the header, we
@@ -58,6 +58,8 @@ static struct device *bcm2835_smi_dev;
 
 struct bcm2835_smi_dev_instance {
 	struct device *dev;
+	atomic_t ring_overflows;
+	atomic_t dma_timeouts;
 };
 
 static struct bcm2835_smi_instance *smi_inst;
@@ -164,12 +166,16 @@ static ssize_t dma_bounce_user(
 		if (down_timeout(&bounce->callback_sem,
 			msecs_to_jiffies(1000))) {
 			dev_err(inst->dev, "DMA bounce timed out");
+			atomic_inc(&inst->dma_timeouts);
 			count -= (count_left);
 			break;
 		}
 
-		if (bounce->callback_sem.count >= DMA_BOUNCE_BUFFER_COUNT - 1)
-			dev_err(inst->dev, "WARNING: Ring buffer overflow");
+		if (bounce->callback_sem.count >= DMA_BOUNCE_BUFFER_COUNT - 1) {
+			dev_err_ratelimited(inst->dev,
+					    "WARNING: Ring buffer overflow");
+			atomic_inc(&inst->ring_overflows);
+		}
 		chunk_size = count_left > DMA_BOUNCE_BUFFER_SIZE ?
 			DMA_BOUNCE_BUFFER_SIZE : count_left;
 		buf = bounce->buffer[chunk_no % DMA_BOUNCE_BUFFER_COUNT];
@@ -257,6 +263,32 @@ bcm2835_write_file(struct file *f, const char __user *user_ptr,
 	return count;
 }
 
+/****************************************************************************
+*
+*   SMI chardev sysfs attributes
+*
+***************************************************************************/
+static ssize_t ring_overflows_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%d\n", atomic_read(&inst->ring_overflows));
+}
+static DEVICE_ATTR_RO(ring_overflows);
+
+static ssize_t dma_timeouts_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%d\n", atomic_read(&inst->dma_timeouts));
+}
+static DEVICE_ATTR_RO(dma_timeouts);
+
+static struct attribute *bcm2835_smi_attrs[] = {
+	&dev_attr_ring_overflows.attr,
+	&dev_attr_dma_timeouts.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(bcm2835_smi);
+
 static const struct file_operations
 bcm2835_smi_fops = {
 	.owner = THIS_MODULE,
@@ -331,9 +363,9 @@ static int bcm2835_smi_dev_probe(struct platform_device *pdev)
 	if (IS_ERR(ptr_err))
 		goto failed_class_create;
 
-	bcm2835_smi_dev = device_create(bcm2835_smi_class, NULL,
-					bcm2835_smi_devid, NULL,
-					"smi");
+	bcm2835_smi_dev = device_create_with_groups(bcm2835_smi_class, NULL,
+						    bcm2835_smi_devid, NULL,
+						    bcm2835_smi_groups, "smi");
 	ptr_err = bcm2835_smi_dev;
 	if (IS_ERR(ptr_err))
 		goto failed_device_create;
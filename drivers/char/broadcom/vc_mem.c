@@ -217,8 +217,12 @@ vc_mem_mmap(struct file *filp, struct vm_area_struct *vma)
 		pr_err("%s: length %ld is too big\n", __func__, length);
 		return -EINVAL;
 	}
-	/* Do not cache the memory map */
-	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	/*
+	 * Do not cache the memory map, but allow write combining: this is
+	 * ordinary RAM owned by the VPU, so device-type mappings only slow
+	 * down bulk reads and writes without adding any coherency.
+	 */
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
 
 	rc = remap_pfn_range(vma, vma->vm_start,
 			     (mm_vc_mem_phys_addr >> PAGE_SHIFT) +
@@ -45,6 +45,10 @@ static int vcio_user_property_list(void *user)
 	if (copy_from_user(&size, user, sizeof(size)))
 		return -EFAULT;
 
+	/* Size, request code and end tag are mandatory */
+	if (size < 12)
+		return -EINVAL;
+
 	buf = kmalloc(size, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
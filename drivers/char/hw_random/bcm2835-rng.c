@@ -4,6 +4,7 @@
  * Copyright (c) 2013 Lubomir Rintel
  */
 
+#include <linux/delay.h>
 #include <linux/hw_random.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
@@ -27,6 +28,10 @@
 
 #define RNG_INT_OFF	0x1
 
+/* roughly the time the generator takes to put another word in the FIFO */
+#define RNG_REFILL_MIN_US	100
+#define RNG_REFILL_MAX_US	200
+
 struct bcm2835_rng_priv {
 	struct hwrng rng;
 	void __iomem *base;
@@ -69,7 +74,8 @@ static int bcm2835_rng_read(struct hwrng *rng, void *buf, size_t max,
 	while ((rng_readl(priv, RNG_STATUS) >> 24) == 0) {
 		if (!wait)
 			return 0;
-		cpu_relax();
+		/* give others a chance to run while the FIFO refills */
+		usleep_range(RNG_REFILL_MIN_US, RNG_REFILL_MAX_US);
 	}
 
 	num_words = rng_readl(priv, RNG_STATUS) >> 24;
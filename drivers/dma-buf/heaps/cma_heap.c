@@ -15,17 +15,319 @@
 #include <linux/errno.h>
 #include <linux/highmem.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
 #include <linux/sched/signal.h>
+#include <linux/workqueue.h>
 
 #include "heap-helpers.h"
 
+/*
+ * Freed buffers can be kept in a per-heap pool and handed out again for
+ * an allocation of the same size, which saves the cma_alloc() migration
+ * work when media pipelines tear down and rebuild their buffer sets.
+ *
+ * The pool holds CMA memory that other CMA users (display, codecs, DMA
+ * engines allocating through dma_alloc_coherent()) cannot reclaim, so it
+ * is kept short-lived and small: entries are released after
+ * CMA_HEAP_POOL_MAX_AGE, the pool never grows past 1/CMA_HEAP_POOL_FRACTION
+ * of the CMA area whatever pool_max_mb says, and it is drained under
+ * memory pressure and when a cma_alloc() from this heap fails.
+ *
+ * Freed buffers are zeroed in the background, so a pooled buffer can be
+ * exported straight away.
+ */
+#define CMA_HEAP_POOL_MAX_AGE	(5 * HZ)
+#define CMA_HEAP_POOL_FRACTION	16
+
+static unsigned int pool_max_mb;
+
+struct cma_heap_pool_entry {
+	struct list_head list;
+	struct page *pages;
+	unsigned long nr_pages;
+	unsigned long freed;	/* jiffies */
+};
+
 struct cma_heap {
 	struct dma_heap *heap;
 	struct cma *cma;
+	struct list_head node;
+
+	struct mutex pool_lock;
+	struct list_head pool;		/* zeroed, most recently freed first */
+	struct list_head dirty;		/* waiting for zero_work */
+	unsigned long pool_pages;	/* on both lists and being zeroed */
+	struct work_struct zero_work;
+	struct delayed_work age_work;
+	struct shrinker pool_shrinker;
+};
+
+static LIST_HEAD(cma_heaps);
+static DEFINE_MUTEX(cma_heaps_lock);
+
+static int cma_heap_clear_pages(struct page *pages, unsigned long nr_pages,
+				bool killable)
+{
+	if (PageHighMem(pages)) {
+		struct page *page = pages;
+
+		while (nr_pages > 0) {
+			void *vaddr = kmap_atomic(page);
+
+			memset(vaddr, 0, PAGE_SIZE);
+			kunmap_atomic(vaddr);
+			/*
+			 * Avoid wasting time zeroing memory if the process
+			 * has been killed by by SIGKILL
+			 */
+			if (killable && fatal_signal_pending(current))
+				return -EINTR;
+			cond_resched();
+
+			page++;
+			nr_pages--;
+		}
+	} else {
+		memset(page_address(pages), 0, nr_pages << PAGE_SHIFT);
+	}
+
+	return 0;
+}
+
+static unsigned long cma_heap_pool_max_pages(struct cma_heap *cma_heap)
+{
+	unsigned long max_pages = (unsigned long)READ_ONCE(pool_max_mb) <<
+				  (20 - PAGE_SHIFT);
+	unsigned long cap = (cma_get_size(cma_heap->cma) >> PAGE_SHIFT) /
+			    CMA_HEAP_POOL_FRACTION;
+
+	return min(max_pages, cap);
+}
+
+/*
+ * Give up to @nr_to_free pages back to CMA, oldest entries first, and only
+ * entries freed more than @min_age jiffies ago. Returns the number of pages
+ * released.
+ */
+static unsigned long cma_heap_pool_release_locked(struct cma_heap *cma_heap,
+						  unsigned long nr_to_free,
+						  unsigned long min_age)
+{
+	struct list_head *lists[] = { &cma_heap->pool, &cma_heap->dirty };
+	struct cma_heap_pool_entry *entry;
+	unsigned long freed = 0;
+	int i;
+
+	lockdep_assert_held(&cma_heap->pool_lock);
+
+	for (i = 0; i < ARRAY_SIZE(lists); i++) {
+		while (freed < nr_to_free && !list_empty(lists[i])) {
+			entry = list_last_entry(lists[i],
+						struct cma_heap_pool_entry,
+						list);
+			if (min_age &&
+			    time_before(jiffies, entry->freed + min_age))
+				break;
+
+			list_del(&entry->list);
+			cma_heap->pool_pages -= entry->nr_pages;
+			cma_release(cma_heap->cma, entry->pages,
+				    entry->nr_pages);
+			freed += entry->nr_pages;
+			kfree(entry);
+		}
+	}
+
+	return freed;
+}
+
+static unsigned long cma_heap_pool_drain(struct cma_heap *cma_heap)
+{
+	unsigned long freed;
+
+	mutex_lock(&cma_heap->pool_lock);
+	freed = cma_heap_pool_release_locked(cma_heap, ULONG_MAX, 0);
+	mutex_unlock(&cma_heap->pool_lock);
+
+	return freed;
+}
+
+static void cma_heap_pool_trim(struct cma_heap *cma_heap)
+{
+	unsigned long max_pages = cma_heap_pool_max_pages(cma_heap);
+
+	mutex_lock(&cma_heap->pool_lock);
+	if (cma_heap->pool_pages > max_pages)
+		cma_heap_pool_release_locked(cma_heap,
+					     cma_heap->pool_pages - max_pages,
+					     0);
+	mutex_unlock(&cma_heap->pool_lock);
+}
+
+static int pool_max_mb_set(const char *val, const struct kernel_param *kp)
+{
+	struct cma_heap *cma_heap;
+	int ret;
+
+	ret = param_set_uint(val, kp);
+	if (ret)
+		return ret;
+
+	/* a lower limit applies to what is already pooled, too */
+	mutex_lock(&cma_heaps_lock);
+	list_for_each_entry(cma_heap, &cma_heaps, node)
+		cma_heap_pool_trim(cma_heap);
+	mutex_unlock(&cma_heaps_lock);
+
+	return 0;
+}
+
+static const struct kernel_param_ops pool_max_mb_ops = {
+	.set = pool_max_mb_set,
+	.get = param_get_uint,
 };
 
+module_param_cb(pool_max_mb, &pool_max_mb_ops, &pool_max_mb, 0644);
+MODULE_PARM_DESC(pool_max_mb, "Max MiB of freed buffers kept for reuse, capped at 1/16 of the CMA area (default: 0 = off)");
+
+static struct page *cma_heap_pool_get(struct cma_heap *cma_heap,
+				      unsigned long nr_pages, bool *zeroed)
+{
+	struct list_head *lists[] = { &cma_heap->pool, &cma_heap->dirty };
+	struct cma_heap_pool_entry *entry, *found = NULL;
+	struct page *pages = NULL;
+	int i;
+
+	mutex_lock(&cma_heap->pool_lock);
+	for (i = 0; i < ARRAY_SIZE(lists) && !found; i++) {
+		list_for_each_entry(entry, lists[i], list) {
+			if (entry->nr_pages == nr_pages) {
+				found = entry;
+				*zeroed = lists[i] == &cma_heap->pool;
+				list_del(&entry->list);
+				cma_heap->pool_pages -= nr_pages;
+				break;
+			}
+		}
+	}
+	mutex_unlock(&cma_heap->pool_lock);
+
+	if (found) {
+		pages = found->pages;
+		kfree(found);
+	}
+
+	return pages;
+}
+
+static bool cma_heap_pool_put(struct cma_heap *cma_heap, struct page *pages,
+			      unsigned long nr_pages)
+{
+	unsigned long max_pages = cma_heap_pool_max_pages(cma_heap);
+	struct cma_heap_pool_entry *entry;
+	bool added = false;
+
+	if (!max_pages)
+		return false;
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return false;
+
+	entry->pages = pages;
+	entry->nr_pages = nr_pages;
+	entry->freed = jiffies;
+
+	mutex_lock(&cma_heap->pool_lock);
+	if (cma_heap->pool_pages + nr_pages <= max_pages) {
+		list_add(&entry->list, &cma_heap->dirty);
+		cma_heap->pool_pages += nr_pages;
+		added = true;
+	}
+	mutex_unlock(&cma_heap->pool_lock);
+
+	if (!added) {
+		kfree(entry);
+		return false;
+	}
+
+	queue_work(system_unbound_wq, &cma_heap->zero_work);
+	schedule_delayed_work(&cma_heap->age_work, CMA_HEAP_POOL_MAX_AGE);
+
+	return true;
+}
+
+static void cma_heap_pool_zero_work(struct work_struct *work)
+{
+	struct cma_heap *cma_heap = container_of(work, struct cma_heap,
+						 zero_work);
+	struct cma_heap_pool_entry *entry;
+
+	for (;;) {
+		mutex_lock(&cma_heap->pool_lock);
+		entry = list_first_entry_or_null(&cma_heap->dirty,
+						 struct cma_heap_pool_entry,
+						 list);
+		if (entry)
+			list_del(&entry->list);
+		mutex_unlock(&cma_heap->pool_lock);
+
+		if (!entry)
+			break;
+
+		cma_heap_clear_pages(entry->pages, entry->nr_pages, false);
+
+		mutex_lock(&cma_heap->pool_lock);
+		list_add(&entry->list, &cma_heap->pool);
+		mutex_unlock(&cma_heap->pool_lock);
+	}
+}
+
+static void cma_heap_pool_age_work(struct work_struct *work)
+{
+	struct cma_heap *cma_heap = container_of(to_delayed_work(work),
+						 struct cma_heap, age_work);
+	bool empty;
+
+	mutex_lock(&cma_heap->pool_lock);
+	cma_heap_pool_release_locked(cma_heap, ULONG_MAX,
+				     CMA_HEAP_POOL_MAX_AGE);
+	empty = !cma_heap->pool_pages;
+	mutex_unlock(&cma_heap->pool_lock);
+
+	if (!empty)
+		schedule_delayed_work(&cma_heap->age_work,
+				      CMA_HEAP_POOL_MAX_AGE);
+}
+
+static unsigned long cma_heap_pool_count(struct shrinker *shrinker,
+					 struct shrink_control *sc)
+{
+	struct cma_heap *cma_heap = container_of(shrinker, struct cma_heap,
+						 pool_shrinker);
+
+	return READ_ONCE(cma_heap->pool_pages) ?: SHRINK_EMPTY;
+}
+
+static unsigned long cma_heap_pool_scan(struct shrinker *shrinker,
+					struct shrink_control *sc)
+{
+	struct cma_heap *cma_heap = container_of(shrinker, struct cma_heap,
+						 pool_shrinker);
+	unsigned long freed;
+
+	if (!mutex_trylock(&cma_heap->pool_lock))
+		return SHRINK_STOP;
+
+	freed = cma_heap_pool_release_locked(cma_heap, sc->nr_to_scan, 0);
+	mutex_unlock(&cma_heap->pool_lock);
+
+	return freed ?: SHRINK_STOP;
+}
+
 static void cma_heap_free(struct heap_helper_buffer *buffer)
 {
 	struct cma_heap *cma_heap = dma_heap_get_drvdata(buffer->heap);
@@ -34,8 +336,9 @@ static void cma_heap_free(struct heap_helper_buffer *buffer)
 
 	/* free page list */
 	kfree(buffer->pages);
-	/* release memory */
-	cma_release(cma_heap->cma, cma_pages, nr_pages);
+	/* keep the memory for reuse, or release it */
+	if (!cma_heap_pool_put(cma_heap, cma_pages, nr_pages))
+		cma_release(cma_heap->cma, cma_pages, nr_pages);
 	kfree(buffer);
 }
 
@@ -52,6 +355,7 @@ static int cma_heap_allocate(struct dma_heap *heap,
 	unsigned long nr_pages = size >> PAGE_SHIFT;
 	unsigned long align = get_order(size);
 	struct dma_buf *dmabuf;
+	bool zeroed = false;
 	int ret = -ENOMEM;
 	pgoff_t pg;
 
@@ -66,32 +370,21 @@ static int cma_heap_allocate(struct dma_heap *heap,
 	helper_buffer->heap = heap;
 	helper_buffer->size = len;
 
-	cma_pages = cma_alloc(cma_heap->cma, nr_pages, align, false);
+	cma_pages = cma_heap_pool_get(cma_heap, nr_pages, &zeroed);
+	if (!cma_pages) {
+		bool pooled = READ_ONCE(cma_heap->pool_pages);
+
+		cma_pages = cma_alloc(cma_heap->cma, nr_pages, align, pooled);
+		/* the pool may be what is keeping the area full */
+		if (!cma_pages && pooled && cma_heap_pool_drain(cma_heap))
+			cma_pages = cma_alloc(cma_heap->cma, nr_pages, align,
+					      false);
+	}
 	if (!cma_pages)
 		goto free_buf;
 
-	if (PageHighMem(cma_pages)) {
-		unsigned long nr_clear_pages = nr_pages;
-		struct page *page = cma_pages;
-
-		while (nr_clear_pages > 0) {
-			void *vaddr = kmap_atomic(page);
-
-			memset(vaddr, 0, PAGE_SIZE);
-			kunmap_atomic(vaddr);
-			/*
-			 * Avoid wasting time zeroing memory if the process
-			 * has been killed by by SIGKILL
-			 */
-			if (fatal_signal_pending(current))
-				goto free_cma;
-
-			page++;
-			nr_clear_pages--;
-		}
-	} else {
-		memset(page_address(cma_pages), 0, size);
-	}
+	if (!zeroed && cma_heap_clear_pages(cma_pages, nr_pages, true))
+		goto free_cma;
 
 	helper_buffer->pagecount = nr_pages;
 	helper_buffer->pages = kmalloc_array(helper_buffer->pagecount,
@@ -141,11 +434,26 @@ static int __add_cma_heap(struct cma *cma, void *data)
 {
 	struct cma_heap *cma_heap;
 	struct dma_heap_export_info exp_info;
+	int ret;
 
 	cma_heap = kzalloc(sizeof(*cma_heap), GFP_KERNEL);
 	if (!cma_heap)
 		return -ENOMEM;
 	cma_heap->cma = cma;
+	mutex_init(&cma_heap->pool_lock);
+	INIT_LIST_HEAD(&cma_heap->pool);
+	INIT_LIST_HEAD(&cma_heap->dirty);
+	INIT_WORK(&cma_heap->zero_work, cma_heap_pool_zero_work);
+	INIT_DELAYED_WORK(&cma_heap->age_work, cma_heap_pool_age_work);
+
+	cma_heap->pool_shrinker.count_objects = cma_heap_pool_count;
+	cma_heap->pool_shrinker.scan_objects = cma_heap_pool_scan;
+	cma_heap->pool_shrinker.seeks = DEFAULT_SEEKS;
+	ret = register_shrinker(&cma_heap->pool_shrinker);
+	if (ret) {
+		kfree(cma_heap);
+		return ret;
+	}
 
 	exp_info.name = cma_get_name(cma);
 	exp_info.ops = &cma_heap_ops;
@@ -153,12 +461,17 @@ static int __add_cma_heap(struct cma *cma, void *data)
 
 	cma_heap->heap = dma_heap_add(&exp_info);
 	if (IS_ERR(cma_heap->heap)) {
-		int ret = PTR_ERR(cma_heap->heap);
+		ret = PTR_ERR(cma_heap->heap);
 
+		unregister_shrinker(&cma_heap->pool_shrinker);
 		kfree(cma_heap);
 		return ret;
 	}
 
+	mutex_lock(&cma_heaps_lock);
+	list_add_tail(&cma_heap->node, &cma_heaps);
+	mutex_unlock(&cma_heaps_lock);
+
 	return 0;
 }
 
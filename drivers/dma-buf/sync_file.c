@@ -211,7 +211,7 @@ static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 					 struct sync_file *b)
 {
 	struct sync_file *sync_file;
-	struct dma_fence **fences, **nfences, **a_fences, **b_fences;
+	struct dma_fence **fences, **a_fences, **b_fences;
 	int i, i_a, i_b, num_fences, a_num_fences, b_num_fences;
 
 	sync_file = sync_file_alloc();
@@ -269,16 +269,14 @@ static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 	if (i == 0)
 		fences[i++] = dma_fence_get(a_fences[0]);
 
-	if (num_fences > i) {
-		nfences = krealloc(fences, i * sizeof(*fences),
-				  GFP_KERNEL);
-		if (!nfences)
-			goto err;
-
-		fences = nfences;
-	}
-
+	/*
+	 * Signaled fences were skipped, so the array may have unused slots
+	 * at its end. Keep them rather than reallocating: the fence array
+	 * only ever looks at the first i entries and frees the whole thing.
+	 */
 	if (sync_file_set_fence(sync_file, fences, i) < 0) {
+		while (i--)
+			dma_fence_put(fences[i]);
 		kfree(fences);
 		goto err;
 	}
@@ -32,13 +32,21 @@
 #include <linux/spinlock.h>
 #include <linux/of.h>
 #include <linux/of_dma.h>
+#include <linux/seq_file.h>
 
+#include "dmaengine.h"
 #include "virt-dma.h"
 
 #define BCM2835_DMA_MAX_DMA_CHAN_SUPPORTED 14
 #define BCM2835_DMA_CHAN_NAME_SIZE 8
 #define BCM2835_DMA_BULK_MASK  BIT(0)
 #define BCM2711_DMA_MEMCPY_CHAN 14
+#define BCM2835_DMA_CB_CACHE_SIZE 32
+
+static unsigned int irq_coalesce = 1;
+module_param(irq_coalesce, uint, 0644);
+MODULE_PARM_DESC(irq_coalesce,
+		 "Raise an interrupt for only every Nth hardware-chained descriptor");
 
 struct bcm2835_dma_cfg_data {
 	u64	dma_mask;
@@ -93,6 +101,9 @@ struct bcm2835_chan {
 
 	int ch;
 	struct bcm2835_desc *desc;
+	/* Descriptors linked in hardware behind desc, in order */
+	struct list_head chained;
+	unsigned int coalesced;
 	struct dma_pool *cb_pool;
 
 	void __iomem *chan_base;
@@ -101,6 +112,16 @@ struct bcm2835_chan {
 
 	bool is_lite_channel;
 	bool is_40bit_channel;
+
+	/*
+	 * Control blocks of completed descriptors, handed out again
+	 * before going back to cb_pool.
+	 */
+	spinlock_t cb_cache_lock;
+	unsigned int cb_cache_count;
+	struct bcm2835_cb_entry cb_cache[BCM2835_DMA_CB_CACHE_SIZE];
+	unsigned long cb_cache_hits;
+	unsigned long cb_cache_misses;
 };
 
 struct bcm2835_desc {
@@ -112,6 +133,8 @@ struct bcm2835_desc {
 	size_t size;
 
 	bool cyclic;
+	/* The last CB's interrupt was cleared for IRQ coalescing */
+	bool irq_suppressed;
 
 	struct bcm2835_cb_entry cb_list[];
 };
@@ -375,13 +398,48 @@ static inline uint32_t to_bcm2711_cbaddr(dma_addr_t addr)
 	return (addr >> 5);
 }
 
+static int bcm2835_dma_cb_alloc(struct bcm2835_chan *c,
+				struct bcm2835_cb_entry *cb_entry, gfp_t gfp)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->cb_cache_lock, flags);
+	if (c->cb_cache_count) {
+		*cb_entry = c->cb_cache[--c->cb_cache_count];
+		c->cb_cache_hits++;
+		spin_unlock_irqrestore(&c->cb_cache_lock, flags);
+		return 0;
+	}
+	c->cb_cache_misses++;
+	spin_unlock_irqrestore(&c->cb_cache_lock, flags);
+
+	cb_entry->cb = dma_pool_alloc(c->cb_pool, gfp, &cb_entry->paddr);
+
+	return cb_entry->cb ? 0 : -ENOMEM;
+}
+
+static void bcm2835_dma_cb_free(struct bcm2835_chan *c,
+				struct bcm2835_cb_entry *cb_entry)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->cb_cache_lock, flags);
+	if (c->cb_cache_count < BCM2835_DMA_CB_CACHE_SIZE) {
+		c->cb_cache[c->cb_cache_count++] = *cb_entry;
+		spin_unlock_irqrestore(&c->cb_cache_lock, flags);
+		return;
+	}
+	spin_unlock_irqrestore(&c->cb_cache_lock, flags);
+
+	dma_pool_free(c->cb_pool, cb_entry->cb, cb_entry->paddr);
+}
+
 static void bcm2835_dma_free_cb_chain(struct bcm2835_desc *desc)
 {
 	size_t i;
 
 	for (i = 0; i < desc->frames; i++)
-		dma_pool_free(desc->c->cb_pool, desc->cb_list[i].cb,
-			      desc->cb_list[i].paddr);
+		bcm2835_dma_cb_free(desc->c, &desc->cb_list[i]);
 
 	kfree(desc);
 }
@@ -509,9 +567,7 @@ static struct bcm2835_desc *bcm2835_dma_create_cb_chain(
 	 */
 	for (frame = 0, total_len = 0; frame < frames; d->frames++, frame++) {
 		cb_entry = &d->cb_list[frame];
-		cb_entry->cb = dma_pool_alloc(c->cb_pool, gfp,
-					      &cb_entry->paddr);
-		if (!cb_entry->cb)
+		if (bcm2835_dma_cb_alloc(c, cb_entry, gfp))
 			goto error_cb;
 
 		/* fill in the control block */
@@ -665,6 +721,186 @@ static void bcm2835_dma_abort(struct bcm2835_chan *c)
 	writel(BCM2835_DMA_RESET, chan_base + BCM2835_DMA_CS);
 }
 
+/* Returns the bus address of the CB the channel is on, 0 when idle. */
+static dma_addr_t bcm2835_dma_cur_cb(struct bcm2835_chan *c)
+{
+	if (c->is_40bit_channel)
+		return (dma_addr_t)readl(c->chan_base + BCM2711_DMA40_CB) << 5;
+
+	return readl(c->chan_base + BCM2835_DMA_ADDR);
+}
+
+static bool bcm2835_dma_desc_has_cb(struct bcm2835_desc *d, dma_addr_t addr)
+{
+	unsigned int i;
+
+	for (i = 0; i < d->frames; i++)
+		if (d->cb_list[i].paddr == addr)
+			return true;
+
+	return false;
+}
+
+static void bcm2835_dma_set_next(struct bcm2835_chan *c,
+				 struct bcm2835_desc *d, dma_addr_t next)
+{
+	void *cb = d->cb_list[d->frames - 1].cb;
+
+	if (c->is_40bit_channel)
+		((struct bcm2711_dma40_scb *)cb)->next_cb =
+			next ? to_bcm2711_cbaddr(next) : 0;
+	else
+		((struct bcm2835_dma_cb *)cb)->next = next;
+}
+
+static void bcm2835_dma_set_irq(struct bcm2835_chan *c,
+				struct bcm2835_desc *d, bool enable)
+{
+	void *cb = d->cb_list[d->frames - 1].cb;
+
+	if (c->is_40bit_channel) {
+		struct bcm2711_dma40_scb *scb = cb;
+
+		if (enable)
+			scb->ti |= BCM2711_DMA40_INTEN;
+		else
+			scb->ti &= ~BCM2711_DMA40_INTEN;
+	} else {
+		struct bcm2835_dma_cb *control_block = cb;
+
+		if (enable)
+			control_block->info |= BCM2835_DMA_INT_EN;
+		else
+			control_block->info &= ~BCM2835_DMA_INT_EN;
+	}
+	d->irq_suppressed = !enable;
+}
+
+/*
+ * Undo the changes made to a descriptor's last CB by chaining, so that a
+ * DMA_CTRL_REUSE descriptor can be submitted again.
+ */
+static void bcm2835_dma_unchain(struct bcm2835_chan *c,
+				struct bcm2835_desc *d)
+{
+	bcm2835_dma_set_next(c, d, 0);
+	if (d->irq_suppressed)
+		bcm2835_dma_set_irq(c, d, true);
+}
+
+/*
+ * Clear ACTIVE and wait for the channel to report that it has paused.
+ * Returns false if it didn't stop within the timeout, e.g. because a
+ * peripheral is holding off an outstanding transfer.
+ */
+static bool bcm2835_dma_pause(struct bcm2835_chan *c)
+{
+	void __iomem *cs = c->chan_base + BCM2835_DMA_CS;
+	u32 paused = BCM2835_DMA_ISPAUSED;
+	long int timeout = 1000;
+
+	if (c->is_40bit_channel) {
+		/* CB fetches go through the read side */
+		paused = BCM2711_DMA40_RD_PAUSED;
+		writel(BCM2711_DMA40_CS_FLAGS(c->dreq), cs);
+	} else {
+		writel(BCM2835_DMA_CS_FLAGS(c->dreq), cs);
+	}
+
+	while (!(readl(cs) & paused) && --timeout)
+		cpu_relax();
+
+	return timeout != 0;
+}
+
+static void bcm2835_dma_resume(struct bcm2835_chan *c)
+{
+	if (c->is_40bit_channel)
+		writel(BCM2711_DMA40_ACTIVE | BCM2711_DMA40_CS_FLAGS(c->dreq),
+		       c->chan_base + BCM2711_DMA40_CS);
+	else
+		writel(BCM2835_DMA_ACTIVE | BCM2835_DMA_CS_FLAGS(c->dreq),
+		       c->chan_base + BCM2835_DMA_CS);
+}
+
+/*
+ * Link @d behind the last descriptor the channel is running, so the
+ * hardware moves on to it without waiting for the completion interrupt.
+ * Returns false if the channel has already gone idle or could not be
+ * paused, in which case the descriptor has to be started from the
+ * interrupt handler as usual.
+ */
+static bool bcm2835_dma_chain_desc(struct bcm2835_chan *c,
+				   struct bcm2835_desc *d)
+{
+	struct bcm2835_desc *tail;
+	dma_addr_t first = d->cb_list[0].paddr;
+	dma_addr_t last, addr;
+
+	if (list_empty(&c->chained))
+		tail = c->desc;
+	else
+		tail = list_last_entry(&c->chained, struct bcm2835_desc,
+				       vd.node);
+	if (!tail || tail->cyclic || d->cyclic)
+		return false;
+
+	last = tail->cb_list[tail->frames - 1].paddr;
+
+	/*
+	 * The channel reads NEXTCONBK when it loads a CB, so if it is
+	 * already on the tail's last CB the register has to be patched as
+	 * well.  Pause the channel while looking, so that it can't move on
+	 * between the check and the write, and don't touch the CBs until it
+	 * has actually stopped fetching.
+	 */
+	if (!bcm2835_dma_pause(c)) {
+		bcm2835_dma_resume(c);
+		return false;
+	}
+
+	if (irq_coalesce > 1 && ++c->coalesced < irq_coalesce)
+		bcm2835_dma_set_irq(c, tail, false);
+	else
+		c->coalesced = 0;
+
+	bcm2835_dma_set_next(c, tail, first);
+	wmb();
+
+	addr = bcm2835_dma_cur_cb(c);
+	if (addr == last) {
+		if (c->is_40bit_channel)
+			writel(to_bcm2711_cbaddr(first),
+			       c->chan_base + BCM2711_DMA40_NEXT_CB);
+		else
+			writel(first, c->chan_base + BCM2835_DMA_NEXTCB);
+	}
+
+	bcm2835_dma_resume(c);
+
+	if (!addr) {
+		/* Too late, the tail has completed already. */
+		bcm2835_dma_unchain(c, tail);
+		return false;
+	}
+
+	return true;
+}
+
+static void bcm2835_dma_chain_issued(struct bcm2835_chan *c)
+{
+	struct virt_dma_desc *vd;
+
+	while (c->desc && (vd = vchan_next_desc(&c->vc))) {
+		list_del(&vd->node);
+		if (!bcm2835_dma_chain_desc(c, to_bcm2835_dma_desc(&vd->tx))) {
+			list_add(&vd->node, &c->vc.desc_issued);
+			break;
+		}
+		list_add_tail(&vd->node, &c->chained);
+	}
+}
+
 static void bcm2835_dma_start_desc(struct bcm2835_chan *c)
 {
 	struct virt_dma_desc *vd = vchan_next_desc(&c->vc);
@@ -720,14 +956,32 @@ static irqreturn_t bcm2835_dma_callback(int irq, void *data)
 
 	d = c->desc;
 
-	if (d) {
-		if (d->cyclic) {
-			/* call the cyclic callback */
-			vchan_cyclic_callback(&d->vd);
-		} else if (!readl(c->chan_base + BCM2835_DMA_ADDR)) {
-			vchan_cookie_complete(&c->desc->vd);
-			bcm2835_dma_start_desc(c);
+	if (d && d->cyclic) {
+		/* call the cyclic callback */
+		vchan_cyclic_callback(&d->vd);
+	} else if (d) {
+		dma_addr_t addr = bcm2835_dma_cur_cb(c);
+
+		/*
+		 * Complete every descriptor the channel has moved past.
+		 * With chaining, and with coalesced interrupts in particular,
+		 * that can be more than one.
+		 */
+		while ((d = c->desc) &&
+		       !(addr && bcm2835_dma_desc_has_cb(d, addr))) {
+			bcm2835_dma_unchain(c, d);
+			vchan_cookie_complete(&d->vd);
+
+			c->desc = list_first_entry_or_null(&c->chained,
+							   struct bcm2835_desc,
+							   vd.node);
+			if (c->desc)
+				list_del(&c->desc->vd.node);
 		}
+
+		if (!c->desc)
+			bcm2835_dma_start_desc(c);
+		bcm2835_dma_chain_issued(c);
 	}
 
 	spin_unlock_irqrestore(&c->vc.lock, flags);
@@ -763,6 +1017,13 @@ static void bcm2835_dma_free_chan_resources(struct dma_chan *chan)
 
 	vchan_free_chan_resources(&c->vc);
 	free_irq(c->irq_number, c);
+
+	while (c->cb_cache_count) {
+		struct bcm2835_cb_entry *cb_entry =
+			&c->cb_cache[--c->cb_cache_count];
+
+		dma_pool_free(c->cb_pool, cb_entry->cb, cb_entry->paddr);
+	}
 	dma_pool_destroy(c->cb_pool);
 
 	dev_dbg(c->vc.chan.device->dev, "Freeing DMA channel %u\n", c->ch);
@@ -797,10 +1058,66 @@ static size_t bcm2835_dma_desc_size_pos(struct bcm2835_desc *d, dma_addr_t addr)
 	return size;
 }
 
+static dma_addr_t bcm2835_dma_cur_pos(struct bcm2835_chan *c,
+				      struct bcm2835_desc *d)
+{
+	if (d->dir == DMA_MEM_TO_DEV && c->is_40bit_channel)
+		return readl(c->chan_base + BCM2711_DMA40_SRC) +
+			((readl(c->chan_base + BCM2711_DMA40_SRCI) &
+			  0xff) << 8);
+	else if (d->dir == DMA_MEM_TO_DEV && !c->is_40bit_channel)
+		return readl(c->chan_base + BCM2835_DMA_SOURCE_AD);
+	else if (d->dir == DMA_DEV_TO_MEM && c->is_40bit_channel)
+		return readl(c->chan_base + BCM2711_DMA40_DEST) +
+			((readl(c->chan_base + BCM2711_DMA40_DESTI) &
+			  0xff) << 8);
+	else if (d->dir == DMA_DEV_TO_MEM && !c->is_40bit_channel)
+		return readl(c->chan_base + BCM2835_DMA_DEST_AD);
+
+	return 0;
+}
+
+/*
+ * Residue of @target, which is either the running descriptor or one that
+ * has been chained behind it.  The hardware can be anywhere in the chain
+ * by now: descriptors before the one owning the current CB are done but
+ * not yet completed by the interrupt handler, those after it are untouched.
+ */
+static size_t bcm2835_dma_chain_residue(struct bcm2835_chan *c,
+					struct bcm2835_desc *target)
+{
+	dma_addr_t addr = bcm2835_dma_cur_cb(c);
+	struct bcm2835_desc *d = c->desc;
+	bool passed = false;
+
+	if (addr && bcm2835_dma_desc_has_cb(d, addr)) {
+		if (d == target)
+			return bcm2835_dma_desc_size_pos(d,
+						bcm2835_dma_cur_pos(c, d));
+		passed = true;
+	} else if (d == target) {
+		return 0;
+	}
+
+	list_for_each_entry(d, &c->chained, vd.node) {
+		if (!passed && addr && bcm2835_dma_desc_has_cb(d, addr)) {
+			if (d == target)
+				return bcm2835_dma_desc_size_pos(d,
+						bcm2835_dma_cur_pos(c, d));
+			passed = true;
+		} else if (d == target) {
+			return passed ? bcm2835_dma_desc_size(d) : 0;
+		}
+	}
+
+	return 0;
+}
+
 static enum dma_status bcm2835_dma_tx_status(struct dma_chan *chan,
 	dma_cookie_t cookie, struct dma_tx_state *txstate)
 {
 	struct bcm2835_chan *c = to_bcm2835_dma_chan(chan);
+	struct bcm2835_desc *cd = NULL;
 	struct virt_dma_desc *vd;
 	enum dma_status ret;
 	unsigned long flags;
@@ -811,29 +1128,24 @@ static enum dma_status bcm2835_dma_tx_status(struct dma_chan *chan,
 
 	spin_lock_irqsave(&c->vc.lock, flags);
 	vd = vchan_find_desc(&c->vc, cookie);
+	if (!vd) {
+		struct bcm2835_desc *d;
+
+		list_for_each_entry(d, &c->chained, vd.node) {
+			if (d->vd.tx.cookie == cookie) {
+				cd = d;
+				break;
+			}
+		}
+	}
+
 	if (vd) {
 		txstate->residue =
 			bcm2835_dma_desc_size(to_bcm2835_dma_desc(&vd->tx));
 	} else if (c->desc && c->desc->vd.tx.cookie == cookie) {
-		struct bcm2835_desc *d = c->desc;
-		dma_addr_t pos;
-
-		if (d->dir == DMA_MEM_TO_DEV && c->is_40bit_channel)
-			pos = readl(c->chan_base + BCM2711_DMA40_SRC) +
-				((readl(c->chan_base + BCM2711_DMA40_SRCI) &
-				  0xff) << 8);
-		else if (d->dir == DMA_MEM_TO_DEV && !c->is_40bit_channel)
-			pos = readl(c->chan_base + BCM2835_DMA_SOURCE_AD);
-		else if (d->dir == DMA_DEV_TO_MEM && c->is_40bit_channel)
-			pos = readl(c->chan_base + BCM2711_DMA40_DEST) +
-				((readl(c->chan_base + BCM2711_DMA40_DESTI) &
-				  0xff) << 8);
-		else if (d->dir == DMA_DEV_TO_MEM && !c->is_40bit_channel)
-			pos = readl(c->chan_base + BCM2835_DMA_DEST_AD);
-		else
-			pos = 0;
-
-		txstate->residue = bcm2835_dma_desc_size_pos(d, pos);
+		txstate->residue = bcm2835_dma_chain_residue(c, c->desc);
+	} else if (cd) {
+		txstate->residue = bcm2835_dma_chain_residue(c, cd);
 	} else {
 		txstate->residue = 0;
 	}
@@ -849,8 +1161,11 @@ static void bcm2835_dma_issue_pending(struct dma_chan *chan)
 	unsigned long flags;
 
 	spin_lock_irqsave(&c->vc.lock, flags);
-	if (vchan_issue_pending(&c->vc) && !c->desc)
-		bcm2835_dma_start_desc(c);
+	if (vchan_issue_pending(&c->vc)) {
+		if (!c->desc)
+			bcm2835_dma_start_desc(c);
+		bcm2835_dma_chain_issued(c);
+	}
 
 	spin_unlock_irqrestore(&c->vc.lock, flags);
 }
@@ -1062,9 +1377,20 @@ static int bcm2835_dma_terminate_all(struct dma_chan *chan)
 
 	/* stop DMA activity */
 	if (c->desc) {
+		struct bcm2835_desc *d, *tmp;
+
+		bcm2835_dma_abort(c);
+
+		bcm2835_dma_unchain(c, c->desc);
 		vchan_terminate_vdesc(&c->desc->vd);
 		c->desc = NULL;
-		bcm2835_dma_abort(c);
+
+		list_for_each_entry_safe(d, tmp, &c->chained, vd.node) {
+			list_del(&d->vd.node);
+			bcm2835_dma_unchain(c, d);
+			vchan_terminate_vdesc(&d->vd);
+		}
+		c->coalesced = 0;
 	}
 
 	vchan_get_all_descriptors(&c->vc, &head);
@@ -1092,6 +1418,8 @@ static int bcm2835_dma_chan_init(struct bcm2835_dmadev *d, int chan_id,
 
 	c->vc.desc_free = bcm2835_dma_desc_free;
 	vchan_init(&c->vc, &d->ddev);
+	INIT_LIST_HEAD(&c->chained);
+	spin_lock_init(&c->cb_cache_lock);
 
 	c->chan_base = BCM2835_DMA_CHANIO(d->base, chan_id);
 	c->ch = chan_id;
@@ -1194,6 +1522,43 @@ static struct dma_chan *bcm2835_dma_xlate(struct of_phandle_args *spec,
 	return chan;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int bcm2835_dma_cb_cache_show(struct seq_file *s, void *unused)
+{
+	struct bcm2835_dmadev *od = s->private;
+	struct bcm2835_chan *c;
+	unsigned long flags;
+
+	list_for_each_entry(c, &od->ddev.channels, vc.chan.device_node) {
+		unsigned int count;
+		unsigned long hits, misses;
+
+		spin_lock_irqsave(&c->cb_cache_lock, flags);
+		count = c->cb_cache_count;
+		hits = c->cb_cache_hits;
+		misses = c->cb_cache_misses;
+		spin_unlock_irqrestore(&c->cb_cache_lock, flags);
+
+		seq_printf(s, "%-8s cached: %2u hits: %lu misses: %lu\n",
+			   dma_chan_name(&c->vc.chan), count, hits, misses);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bcm2835_dma_cb_cache);
+
+static void bcm2835_dma_debugfs_init(struct bcm2835_dmadev *od)
+{
+	debugfs_create_file("cb_cache", 0444,
+			    dmaengine_get_debugfs_root(&od->ddev), od,
+			    &bcm2835_dma_cb_cache_fops);
+}
+#else
+static inline void bcm2835_dma_debugfs_init(struct bcm2835_dmadev *od)
+{
+}
+#endif
+
 static int bcm2835_dma_probe(struct platform_device *pdev)
 {
 	const struct bcm2835_dma_cfg_data *cfg_data;
@@ -1390,6 +1755,8 @@ static int bcm2835_dma_probe(struct platform_device *pdev)
 		goto err_no_dma;
 	}
 
+	bcm2835_dma_debugfs_init(od);
+
 	dev_dbg(&pdev->dev, "Load BCM2835 DMA engine driver\n");
 
 	return 0;
@@ -13,6 +13,7 @@
 #include <linux/platform_device.h>
 #include <linux/reboot.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 #include <soc/bcm2835/raspberrypi-firmware.h>
 
 #define MBOX_MSG(chan, data28)		(((data28) & ~0xf) | ((chan) & 0xf))
@@ -20,6 +21,17 @@
 #define MBOX_DATA28(msg)		((msg) & ~0xf)
 #define MBOX_CHAN_PROPERTY		8
 
+/* Set by the firmware in req_resp_size once it has answered a tag. */
+#define RPI_FIRMWARE_TAG_RESPONSE	BIT(31)
+
+/*
+ * Number and size of the coherent property buffers preallocated at probe
+ * time. Anything larger (or arriving while all of them are in use) falls
+ * back to a one-off dma_alloc_coherent().
+ */
+#define RPI_FIRMWARE_POOL_BUFS		4
+#define RPI_FIRMWARE_POOL_BUF_SIZE	PAGE_SIZE
+
 static struct platform_device *rpi_hwmon;
 static struct platform_device *rpi_clk;
 
@@ -29,6 +41,15 @@ struct rpi_firmware {
 	struct completion c;
 	u32 enabled;
 	u32 get_throttled;
+
+	void *pool_buf[RPI_FIRMWARE_POOL_BUFS];
+	dma_addr_t pool_bus[RPI_FIRMWARE_POOL_BUFS];
+	unsigned long pool_free; /* Bitmap of idle pool_buf[] entries. */
+
+	/* Tags queued by rpi_firmware_property_queue(). */
+	struct list_head async_list;
+	spinlock_t async_lock;
+	struct work_struct async_work;
 };
 
 static struct platform_device *g_pdev;
@@ -72,6 +93,79 @@ rpi_firmware_transaction(struct rpi_firmware *fw, u32 chan, u32 data)
 }
 EXPORT_SYMBOL_GPL(rpi_firmware_transaction);
 
+static u32 *rpi_firmware_buf_get(struct rpi_firmware *fw, size_t size,
+				 dma_addr_t *bus_addr, int *slot)
+{
+	int i;
+
+	if (size <= RPI_FIRMWARE_POOL_BUF_SIZE) {
+		for_each_set_bit(i, &fw->pool_free, RPI_FIRMWARE_POOL_BUFS) {
+			if (test_and_clear_bit(i, &fw->pool_free)) {
+				*slot = i;
+				*bus_addr = fw->pool_bus[i];
+				return fw->pool_buf[i];
+			}
+		}
+	}
+
+	*slot = -1;
+	return dma_alloc_coherent(fw->cl.dev, PAGE_ALIGN(size), bus_addr,
+				  GFP_ATOMIC);
+}
+
+static void rpi_firmware_buf_put(struct rpi_firmware *fw, u32 *buf,
+				 size_t size, dma_addr_t bus_addr, int slot)
+{
+	if (slot >= 0)
+		set_bit(slot, &fw->pool_free);
+	else
+		dma_free_coherent(fw->cl.dev, PAGE_ALIGN(size), buf, bus_addr);
+}
+
+/*
+ * Wraps the tags already copied to &buf[2] in the property buffer header
+ * and end tag, and hands the buffer to the firmware.
+ */
+static int rpi_firmware_buf_transaction(struct rpi_firmware *fw, u32 *buf,
+					dma_addr_t bus_addr, size_t size)
+{
+	int ret;
+
+	/* The firmware will error out without parsing in this case. */
+	WARN_ON(size >= 1024 * 1024);
+
+	buf[0] = size;
+	buf[1] = RPI_FIRMWARE_STATUS_REQUEST;
+	buf[size / 4 - 1] = RPI_FIRMWARE_PROPERTY_END;
+	wmb();
+
+	ret = rpi_firmware_transaction(fw, MBOX_CHAN_PROPERTY, bus_addr);
+
+	rmb();
+	if (ret == 0 && buf[1] != RPI_FIRMWARE_STATUS_SUCCESS) {
+		/*
+		 * The tag name here might not be the one causing the
+		 * error, if there were multiple tags in the request.
+		 * But single-tag is the most common, so go with it.
+		 */
+		dev_err(fw->cl.dev, "Request 0x%08x returned status 0x%08x\n",
+			buf[2], buf[1]);
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static void rpi_firmware_update_throttled(struct rpi_firmware *fw, u32 tag,
+					  const void *tag_data)
+{
+	if ((tag == RPI_FIRMWARE_GET_THROTTLED) &&
+	     memcmp(&fw->get_throttled, tag_data, sizeof(fw->get_throttled))) {
+		memcpy(&fw->get_throttled, tag_data, sizeof(fw->get_throttled));
+		sysfs_notify(&fw->cl.dev->kobj, NULL, "get_throttled");
+	}
+}
+
 /**
  * rpi_firmware_property_list - Submit firmware property list
  * @fw:		Pointer to firmware structure from rpi_firmware_get().
@@ -92,42 +186,24 @@ int rpi_firmware_property_list(struct rpi_firmware *fw,
 	size_t size = tag_size + 12;
 	u32 *buf;
 	dma_addr_t bus_addr;
+	int slot;
 	int ret;
 
 	/* Packets are processed a dword at a time. */
 	if (size & 3)
 		return -EINVAL;
 
-	buf = dma_alloc_coherent(fw->cl.dev, PAGE_ALIGN(size), &bus_addr,
-				 GFP_ATOMIC);
+	buf = rpi_firmware_buf_get(fw, size, &bus_addr, &slot);
 	if (!buf)
 		return -ENOMEM;
 
-	/* The firmware will error out without parsing in this case. */
-	WARN_ON(size >= 1024 * 1024);
-
-	buf[0] = size;
-	buf[1] = RPI_FIRMWARE_STATUS_REQUEST;
 	memcpy(&buf[2], data, tag_size);
-	buf[size / 4 - 1] = RPI_FIRMWARE_PROPERTY_END;
-	wmb();
 
-	ret = rpi_firmware_transaction(fw, MBOX_CHAN_PROPERTY, bus_addr);
+	ret = rpi_firmware_buf_transaction(fw, buf, bus_addr, size);
 
-	rmb();
 	memcpy(data, &buf[2], tag_size);
-	if (ret == 0 && buf[1] != RPI_FIRMWARE_STATUS_SUCCESS) {
-		/*
-		 * The tag name here might not be the one causing the
-		 * error, if there were multiple tags in the request.
-		 * But single-tag is the most common, so go with it.
-		 */
-		dev_err(fw->cl.dev, "Request 0x%08x returned status 0x%08x\n",
-			buf[2], buf[1]);
-		ret = -EINVAL;
-	}
 
-	dma_free_coherent(fw->cl.dev, PAGE_ALIGN(size), buf, bus_addr);
+	rpi_firmware_buf_put(fw, buf, size, bus_addr, slot);
 
 	return ret;
 }
@@ -175,16 +251,138 @@ int rpi_firmware_property(struct rpi_firmware *fw,
 
 	kfree(data);
 
-	if ((tag == RPI_FIRMWARE_GET_THROTTLED) &&
-	     memcmp(&fw->get_throttled, tag_data, sizeof(fw->get_throttled))) {
-		memcpy(&fw->get_throttled, tag_data, sizeof(fw->get_throttled));
-		sysfs_notify(&fw->cl.dev->kobj, NULL, "get_throttled");
-	}
+	rpi_firmware_update_throttled(fw, tag, tag_data);
 
 	return ret;
 }
 EXPORT_SYMBOL_GPL(rpi_firmware_property);
 
+static size_t rpi_firmware_async_len(struct rpi_firmware_async_tag *req)
+{
+	return sizeof(struct rpi_firmware_property_tag_header) + req->buf_size;
+}
+
+/*
+ * Sends every tag on @batch as a single property message, then copies
+ * the responses back and completes the requests.
+ */
+static void rpi_firmware_async_batch(struct rpi_firmware *fw,
+				     struct list_head *batch, size_t size)
+{
+	struct rpi_firmware_property_tag_header *header;
+	struct rpi_firmware_async_tag *req, *tmp;
+	dma_addr_t bus_addr;
+	u32 *buf;
+	int slot;
+	int ret;
+
+	buf = rpi_firmware_buf_get(fw, size, &bus_addr, &slot);
+	if (!buf) {
+		list_for_each_entry_safe(req, tmp, batch, node) {
+			list_del(&req->node);
+			req->complete(req, -ENOMEM);
+		}
+		return;
+	}
+
+	header = (void *)&buf[2];
+	list_for_each_entry(req, batch, node) {
+		header->tag = req->tag;
+		header->buf_size = req->buf_size;
+		header->req_resp_size = 0;
+		memcpy(header + 1, req->data, req->buf_size);
+		header = (void *)header + rpi_firmware_async_len(req);
+	}
+
+	ret = rpi_firmware_buf_transaction(fw, buf, bus_addr, size);
+
+	header = (void *)&buf[2];
+	list_for_each_entry_safe(req, tmp, batch, node) {
+		int tag_ret = ret;
+
+		memcpy(req->data, header + 1, req->buf_size);
+		if (!tag_ret &&
+		    !(header->req_resp_size & RPI_FIRMWARE_TAG_RESPONSE))
+			tag_ret = -EINVAL;
+		header = (void *)header + rpi_firmware_async_len(req);
+
+		if (!tag_ret)
+			rpi_firmware_update_throttled(fw, req->tag, req->data);
+
+		list_del(&req->node);
+		req->complete(req, tag_ret);
+	}
+
+	rpi_firmware_buf_put(fw, buf, size, bus_addr, slot);
+}
+
+static void rpi_firmware_async_work(struct work_struct *work)
+{
+	struct rpi_firmware *fw = container_of(work, struct rpi_firmware,
+					       async_work);
+	struct rpi_firmware_async_tag *req, *tmp;
+	LIST_HEAD(batch);
+	size_t size;
+
+	for (;;) {
+		/*
+		 * Coalesce as many queued tags as fit in one pool buffer.
+		 * An oversized tag still goes out, on its own.
+		 */
+		size = 12;
+		spin_lock_irq(&fw->async_lock);
+		list_for_each_entry_safe(req, tmp, &fw->async_list, node) {
+			size_t len = rpi_firmware_async_len(req);
+
+			if (!list_empty(&batch) &&
+			    size + len > RPI_FIRMWARE_POOL_BUF_SIZE)
+				break;
+			list_move_tail(&req->node, &batch);
+			size += len;
+		}
+		spin_unlock_irq(&fw->async_lock);
+
+		if (list_empty(&batch))
+			break;
+
+		rpi_firmware_async_batch(fw, &batch, size);
+	}
+}
+
+/**
+ * rpi_firmware_property_queue - Queue a firmware property tag
+ * @fw:		Pointer to firmware structure from rpi_firmware_get().
+ * @req:	Tag to submit. Must stay valid until @req->complete runs.
+ *
+ * Queues a single tag for asynchronous submission. Tags queued by
+ * independent callers are coalesced into one mailbox message, so
+ * drivers polling the firmware share a single round trip rather than
+ * paying for one each.
+ *
+ * @req->complete is called from process context with 0 on success, or
+ * a negative error code if the message failed or the firmware did not
+ * answer this particular tag. This function may be called from atomic
+ * context.
+ */
+int rpi_firmware_property_queue(struct rpi_firmware *fw,
+				struct rpi_firmware_async_tag *req)
+{
+	unsigned long flags;
+
+	/* Packets are processed a dword at a time. */
+	if ((req->buf_size & 3) || !req->complete)
+		return -EINVAL;
+
+	spin_lock_irqsave(&fw->async_lock, flags);
+	list_add_tail(&req->node, &fw->async_list);
+	spin_unlock_irqrestore(&fw->async_lock, flags);
+
+	queue_work(system_highpri_wq, &fw->async_work);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rpi_firmware_property_queue);
+
 static int rpi_firmware_notify_reboot(struct notifier_block *nb,
 				      unsigned long action,
 				      void *data)
@@ -344,6 +542,7 @@ static int rpi_firmware_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
 	struct rpi_firmware *fw;
+	int i;
 
 	fw = devm_kzalloc(dev, sizeof(*fw), GFP_KERNEL);
 	if (!fw)
@@ -362,6 +561,19 @@ static int rpi_firmware_probe(struct platform_device *pdev)
 	}
 
 	init_completion(&fw->c);
+	INIT_LIST_HEAD(&fw->async_list);
+	spin_lock_init(&fw->async_lock);
+	INIT_WORK(&fw->async_work, rpi_firmware_async_work);
+
+	/* The pool is only an optimisation, so carry on without it. */
+	for (i = 0; i < RPI_FIRMWARE_POOL_BUFS; i++) {
+		fw->pool_buf[i] = dmam_alloc_coherent(dev,
+						      RPI_FIRMWARE_POOL_BUF_SIZE,
+						      &fw->pool_bus[i],
+						      GFP_KERNEL);
+		if (fw->pool_buf[i])
+			set_bit(i, &fw->pool_free);
+	}
 
 	platform_set_drvdata(pdev, fw);
 	g_pdev = pdev;
@@ -387,11 +599,23 @@ static void rpi_firmware_shutdown(struct platform_device *pdev)
 static int rpi_firmware_remove(struct platform_device *pdev)
 {
 	struct rpi_firmware *fw = platform_get_drvdata(pdev);
+	struct rpi_firmware_async_tag *req, *tmp;
+	LIST_HEAD(pending);
 
 	platform_device_unregister(rpi_hwmon);
 	rpi_hwmon = NULL;
 	platform_device_unregister(rpi_clk);
 	rpi_clk = NULL;
+	cancel_work_sync(&fw->async_work);
+
+	spin_lock_irq(&fw->async_lock);
+	list_splice_init(&fw->async_list, &pending);
+	spin_unlock_irq(&fw->async_lock);
+
+	list_for_each_entry_safe(req, tmp, &pending, node) {
+		list_del(&req->node);
+		req->complete(req, -ENODEV);
+	}
 	mbox_free_channel(fw->chan);
 	g_pdev = NULL;
 
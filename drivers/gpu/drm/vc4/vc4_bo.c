@@ -17,6 +17,7 @@
  */
 
 #include <linux/dma-buf.h>
+#include <linux/log2.h>
 
 #include "vc4_drv.h"
 #include "uapi/drm/vc4_drm.h"
@@ -37,6 +38,29 @@ static bool is_user_label(int label)
 	return label >= VC4_BO_TYPE_COUNT;
 }
 
+static unsigned int bo_size_class(size_t size)
+{
+	unsigned long pages = DIV_ROUND_UP(size, PAGE_SIZE);
+
+	return min_t(unsigned int, order_base_2(pages),
+		     VC4_BO_CACHE_SIZE_CLASSES - 1);
+}
+
+/* Returns how long an unused BO stays in the kernel BO cache before
+ * being freed, scaled up with the recent cache hit rate.
+ */
+static unsigned long vc4_bo_cache_timeout(struct vc4_dev *vc4)
+{
+	unsigned int hits = vc4->bo_cache.recent_hits;
+	unsigned int total = hits + vc4->bo_cache.recent_misses;
+
+	if (total >= 16 && hits * 4 >= total * 3)
+		return msecs_to_jiffies(4000);
+	if (total >= 16 && hits * 2 >= total)
+		return msecs_to_jiffies(2000);
+	return msecs_to_jiffies(1000);
+}
+
 static void vc4_bo_stats_print(struct drm_printer *p, struct vc4_dev *vc4)
 {
 	int i;
@@ -51,6 +75,27 @@ static void vc4_bo_stats_print(struct drm_printer *p, struct vc4_dev *vc4)
 			   vc4->bo_labels[i].num_allocated);
 	}
 
+	mutex_lock(&vc4->bo_lock);
+	for (i = 0; i < VC4_BO_CACHE_SIZE_CLASSES; i++) {
+		unsigned long hits = vc4->bo_cache.hits[i];
+		unsigned long misses = vc4->bo_cache.misses[i];
+
+		if (!hits && !misses)
+			continue;
+
+		if (i == VC4_BO_CACHE_SIZE_CLASSES - 1)
+			drm_printf(p, "%23s >%4lukb: %lu hits, %lu misses\n",
+				   "BO cache",
+				   (PAGE_SIZE << (i - 1)) / 1024, hits, misses);
+		else
+			drm_printf(p, "%23s <=%4lukb: %lu hits, %lu misses\n",
+				   "BO cache",
+				   (PAGE_SIZE << i) / 1024, hits, misses);
+	}
+	drm_printf(p, "%30s: %ums\n", "BO cache timeout",
+		   jiffies_to_msecs(vc4_bo_cache_timeout(vc4)));
+	mutex_unlock(&vc4->bo_lock);
+
 	mutex_lock(&vc4->purgeable.lock);
 	if (vc4->purgeable.num)
 		drm_printf(p, "%30s: %6zdkb BOs (%d)\n", "userspace BO cache",
@@ -351,6 +396,7 @@ static struct vc4_bo *vc4_bo_get_from_cache(struct drm_device *dev,
 {
 	struct vc4_dev *vc4 = to_vc4_dev(dev);
 	uint32_t page_index = bo_page_index(size);
+	unsigned int class = bo_size_class(size);
 	struct vc4_bo *bo = NULL;
 
 	size = roundup(size, PAGE_SIZE);
@@ -368,8 +414,14 @@ static struct vc4_bo *vc4_bo_get_from_cache(struct drm_device *dev,
 	kref_init(&bo->base.base.refcount);
 
 out:
-	if (bo)
+	if (bo) {
 		vc4_bo_set_label(&bo->base.base, type);
+		vc4->bo_cache.hits[class]++;
+		vc4->bo_cache.recent_hits++;
+	} else {
+		vc4->bo_cache.misses[class]++;
+		vc4->bo_cache.recent_misses++;
+	}
 	mutex_unlock(&vc4->bo_lock);
 	return bo;
 }
@@ -498,7 +550,8 @@ int vc4_dumb_create(struct drm_file *file_priv,
 static void vc4_bo_cache_free_old(struct drm_device *dev)
 {
 	struct vc4_dev *vc4 = to_vc4_dev(dev);
-	unsigned long expire_time = jiffies - msecs_to_jiffies(1000);
+	unsigned long timeout = vc4_bo_cache_timeout(vc4);
+	unsigned long expire_time = jiffies - timeout;
 
 	lockdep_assert_held(&vc4->bo_lock);
 
@@ -507,8 +560,7 @@ static void vc4_bo_cache_free_old(struct drm_device *dev)
 						    struct vc4_bo, unref_head);
 		if (time_before(expire_time, bo->free_time)) {
 			mod_timer(&vc4->bo_cache.time_timer,
-				  round_jiffies_up(jiffies +
-						   msecs_to_jiffies(1000)));
+				  round_jiffies_up(bo->free_time + timeout));
 			return;
 		}
 
@@ -593,6 +645,8 @@ static void vc4_bo_cache_time_work(struct work_struct *work)
 	struct drm_device *dev = &vc4->base;
 
 	mutex_lock(&vc4->bo_lock);
+	vc4->bo_cache.recent_hits /= 2;
+	vc4->bo_cache.recent_misses /= 2;
 	vc4_bo_cache_free_old(dev);
 	mutex_unlock(&vc4->bo_lock);
 }
@@ -866,6 +920,7 @@ vc4_create_shader_bo_ioctl(struct drm_device *dev, void *data,
 	struct vc4_file *vc4file = file_priv->driver_priv;
 	struct vc4_dev *vc4 = to_vc4_dev(dev);
 	struct vc4_bo *bo = NULL;
+	ktime_t start;
 	int ret;
 
 	if (args->size == 0)
@@ -906,7 +961,9 @@ vc4_create_shader_bo_ioctl(struct drm_device *dev, void *data,
 	memset(bo->base.vaddr + args->size, 0,
 	       bo->base.base.size - args->size);
 
+	start = ktime_get();
 	bo->validated_shader = vc4_validate_shader(&bo->base);
+	vc4_validation_stats_add_shader(vc4, start);
 	if (!bo->validated_shader) {
 		ret = -EINVAL;
 		goto fail;
@@ -16,6 +16,35 @@ struct vc4_debugfs_info_entry {
 	struct drm_info_list info;
 };
 
+static int vc4_validation_stats_debugfs(struct seq_file *m, void *unused)
+{
+	struct drm_info_node *node = (struct drm_info_node *)m->private;
+	struct vc4_dev *vc4 = to_vc4_dev(node->minor->dev);
+	u64 jobs, job_ns, job_max_ns, shaders, shader_ns;
+
+	spin_lock(&vc4->validation_stats.lock);
+	jobs = vc4->validation_stats.jobs;
+	job_ns = vc4->validation_stats.job_ns;
+	job_max_ns = vc4->validation_stats.job_max_ns;
+	shaders = vc4->validation_stats.shaders;
+	shader_ns = vc4->validation_stats.shader_ns;
+	spin_unlock(&vc4->validation_stats.lock);
+
+	seq_printf(m, "jobs validated:     %llu\n", jobs);
+	seq_printf(m, "job total ns:       %llu\n", job_ns);
+	seq_printf(m, "job average ns:     %llu\n",
+		   jobs ? div64_u64(job_ns, jobs) : 0);
+	seq_printf(m, "job max ns:         %llu\n", job_max_ns);
+	seq_printf(m, "shaders validated:  %llu\n", shaders);
+	seq_printf(m, "shader total ns:    %llu\n", shader_ns);
+
+	return 0;
+}
+
+static const struct drm_info_list vc4_debugfs_list[] = {
+	{"validation_stats", vc4_validation_stats_debugfs, 0},
+};
+
 /**
  * Called at drm_dev_register() time on each of the minors registered
  * by the DRM device, to attach the debugfs files.
@@ -29,6 +58,10 @@ vc4_debugfs_init(struct drm_minor *minor)
 	debugfs_create_bool("hvs_load_tracker", S_IRUGO | S_IWUSR,
 			    minor->debugfs_root, &vc4->load_tracker_enabled);
 
+	drm_debugfs_create_files(vc4_debugfs_list,
+				 ARRAY_SIZE(vc4_debugfs_list),
+				 minor->debugfs_root, minor);
+
 	list_for_each_entry(entry, &vc4->debugfs_list, link) {
 		drm_debugfs_create_files(&entry->info, 1,
 					 minor->debugfs_root, minor);
@@ -75,6 +108,38 @@ void vc4_debugfs_add_file(struct drm_device *dev,
 	list_add(&entry->link, &vc4->debugfs_list);
 }
 
+/**
+ * vc4_validation_stats_add_job() - Accounts the CL validation of a job.
+ * @vc4: VC4 device
+ * @start: ktime_get() value from before validation started
+ */
+void vc4_validation_stats_add_job(struct vc4_dev *vc4, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&vc4->validation_stats.lock);
+	vc4->validation_stats.jobs++;
+	vc4->validation_stats.job_ns += ns;
+	if (ns > vc4->validation_stats.job_max_ns)
+		vc4->validation_stats.job_max_ns = ns;
+	spin_unlock(&vc4->validation_stats.lock);
+}
+
+/**
+ * vc4_validation_stats_add_shader() - Accounts the validation of a shader BO.
+ * @vc4: VC4 device
+ * @start: ktime_get() value from before validation started
+ */
+void vc4_validation_stats_add_shader(struct vc4_dev *vc4, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&vc4->validation_stats.lock);
+	vc4->validation_stats.shaders++;
+	vc4->validation_stats.shader_ns += ns;
+	spin_unlock(&vc4->validation_stats.lock);
+}
+
 void vc4_debugfs_add_regset32(struct drm_device *drm,
 			      const char *name,
 			      struct debugfs_regset32 *regset)
@@ -124,6 +124,7 @@ static int vc4_open(struct drm_device *dev, struct drm_file *file)
 		return -ENOMEM;
 
 	vc4_perfmon_open_file(vc4file);
+	mutex_init(&vc4file->bcl.lock);
 	file->driver_priv = vc4file;
 	return 0;
 }
@@ -137,6 +138,8 @@ static void vc4_close(struct drm_device *dev, struct drm_file *file)
 		vc4_v3d_bin_bo_put(vc4);
 
 	vc4_perfmon_close_file(vc4file);
+	kvfree(vc4file->bcl.scratch);
+	mutex_destroy(&vc4file->bcl.lock);
 	kfree(vc4file);
 }
 
@@ -7,6 +7,7 @@
 
 #include <linux/delay.h>
 #include <linux/refcount.h>
+#include <linux/sizes.h>
 #include <linux/uaccess.h>
 
 #include <drm/drm_atomic.h>
@@ -71,6 +72,11 @@ struct vc4_perfmon {
 	u64 counters[];
 };
 
+/* Number of size classes the BO cache keeps statistics for: 1, 2, 3-4,
+ * 5-8, ... pages, with the last class covering everything bigger.
+ */
+#define VC4_BO_CACHE_SIZE_CLASSES	10
+
 struct vc4_dev {
 	struct drm_device base;
 
@@ -108,6 +114,20 @@ struct vc4_dev {
 		struct list_head time_list;
 		struct work_struct time_work;
 		struct timer_list time_timer;
+
+		/* Lookup hits and misses, bucketed by power-of-two
+		 * size class in pages, for the bo_stats debugfs file.
+		 */
+		unsigned long hits[VC4_BO_CACHE_SIZE_CLASSES];
+		unsigned long misses[VC4_BO_CACHE_SIZE_CLASSES];
+
+		/* Decaying hit/miss counts, halved each time
+		 * time_work runs.  When most lookups are being
+		 * satisfied from the cache, BOs are kept around for
+		 * longer before being returned to CMA.
+		 */
+		unsigned int recent_hits;
+		unsigned int recent_misses;
 	} bo_cache;
 
 	u32 num_labels;
@@ -233,6 +253,21 @@ struct vc4_dev {
 	 */
 	struct list_head debugfs_list;
 
+	/* Time spent validating submitted command lists and shaders,
+	 * reported through the "validation_stats" debugfs file.
+	 * Shaders are validated once, when their BO is created, so
+	 * shader_ns only grows with CREATE_SHADER_BO calls and not with
+	 * the number of jobs that use them.
+	 */
+	struct {
+		spinlock_t lock;
+		u64 jobs;
+		u64 job_ns;
+		u64 job_max_ns;
+		u64 shaders;
+		u64 shader_ns;
+	} validation_stats;
+
 	/* Mutex for binner bo allocation. */
 	struct mutex bin_bo_lock;
 	/* Reference count for our binner bo. */
@@ -342,6 +377,21 @@ struct vc4_hvs {
 
 	struct drm_mm_node mitchell_netravali_filter;
 
+	/* CPU copy of the display list memory, so that dlist writes
+	 * can skip words that already hold the value being written.
+	 * Each commit gets a freshly allocated dlist region, and for
+	 * a steady stream of flips drm_mm tends to hand back the
+	 * region freed by the commit before last, so only the words
+	 * that changed since then (typically the plane pointers)
+	 * need to go out over the bus.  A word is only trusted while
+	 * its bit in dlist_shadow_valid is set; resetting a channel
+	 * clears the lot.
+	 */
+	u32 *dlist_shadow;
+	unsigned long *dlist_shadow_valid;
+	atomic64_t dlist_words_written;
+	atomic64_t dlist_words_skipped;
+
 	struct debugfs_regset32 regset;
 
 	/* HVS version 5 flag, therefore requires updated dlist structures */
@@ -364,6 +414,11 @@ enum vc4_scaling_mode {
 	VC4_SCALING_PPF,
 };
 
+/* Placeholder value for the dlist words that the HVS writes its own
+ * context into while scanning out.
+ */
+#define VC4_DLIST_CONTEXT_WORD	0xc0c0c0c0
+
 struct vc4_plane_state {
 	struct drm_plane_state base;
 	/* System memory copy of the display list for this element, computed
@@ -685,9 +740,21 @@ struct vc4_file {
 		struct mutex lock;
 	} perfmon;
 
+	/* Scratch storage that vc4_get_bcl() copies the CLs into, kept
+	 * around between submits.  It only ever grows, up to
+	 * VC4_BCL_SCRATCH_MAX, and is protected by the mutex.
+	 */
+	struct {
+		struct mutex lock;
+		void *scratch;
+		size_t size;
+	} bcl;
+
 	bool bin_bo_used;
 };
 
+#define VC4_BCL_SCRATCH_MAX	SZ_256K
+
 static inline struct vc4_exec_info *
 vc4_first_bin_job(struct vc4_dev *vc4)
 {
@@ -849,6 +916,8 @@ void vc4_crtc_get_margins(struct drm_crtc_state *state,
 /* vc4_debugfs.c */
 void vc4_debugfs_init(struct drm_minor *minor);
 #ifdef CONFIG_DEBUG_FS
+void vc4_validation_stats_add_job(struct vc4_dev *vc4, ktime_t start);
+void vc4_validation_stats_add_shader(struct vc4_dev *vc4, ktime_t start);
 void vc4_debugfs_add_file(struct drm_device *drm,
 			  const char *filename,
 			  int (*show)(struct seq_file*, void*),
@@ -857,6 +926,16 @@ void vc4_debugfs_add_regset32(struct drm_device *drm,
 			      const char *filename,
 			      struct debugfs_regset32 *regset);
 #else
+static inline void vc4_validation_stats_add_job(struct vc4_dev *vc4,
+						ktime_t start)
+{
+}
+
+static inline void vc4_validation_stats_add_shader(struct vc4_dev *vc4,
+						   ktime_t start)
+{
+}
+
 static inline void vc4_debugfs_add_file(struct drm_device *drm,
 					const char *filename,
 					int (*show)(struct seq_file*, void*),
@@ -934,6 +1013,10 @@ void vc4_hvs_atomic_flush(struct drm_crtc *crtc,
 void vc4_hvs_dump_state(struct drm_device *dev);
 void vc4_hvs_unmask_underrun(struct drm_device *dev, int channel);
 void vc4_hvs_mask_underrun(struct drm_device *dev, int channel);
+void vc4_hvs_write_dlist(struct vc4_hvs *hvs, u32 __iomem *dst,
+			 const u32 *src, unsigned int count);
+void vc4_hvs_write_dlist_word(struct vc4_hvs *hvs, u32 __iomem *dst, u32 val);
+void vc4_hvs_invalidate_dlist_shadow(struct vc4_hvs *hvs);
 
 /* vc4_kms.c */
 int vc4_kms_load(struct drm_device *dev);
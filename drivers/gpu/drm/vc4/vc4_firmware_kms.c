@@ -268,6 +268,14 @@ struct vc4_crtc {
 	bool vblank_enabled;
 	u32 display_number;
 	u32 display_type;
+
+	/*
+	 * SET_PLANE tags queued by the plane update/disable hooks of a
+	 * commit, sent to the firmware as one property list from
+	 * atomic_flush.
+	 */
+	struct mailbox_set_plane pending_planes[PLANES_PER_CRTC];
+	unsigned int num_pending_planes;
 };
 
 static inline struct vc4_crtc *to_vc4_crtc(struct drm_crtc *crtc)
@@ -370,9 +378,10 @@ static inline struct vc4_fkms_plane *to_vc4_fkms_plane(struct drm_plane *plane)
 	return (struct vc4_fkms_plane *)plane;
 }
 
-static int vc4_plane_set_blank(struct drm_plane *plane, bool blank)
+/* Fill in the SET_PLANE tag that blanks or shows @plane. */
+static void vc4_plane_get_blank_mb(struct drm_plane *plane, bool blank,
+				   struct mailbox_set_plane *mb)
 {
-	struct vc4_dev *vc4 = to_vc4_dev(plane->dev);
 	struct vc4_fkms_plane *vc4_plane = to_vc4_fkms_plane(plane);
 	struct mailbox_set_plane blank_mb = {
 		.tag = { RPI_FIRMWARE_SET_PLANE, sizeof(struct set_plane), 0 },
@@ -386,24 +395,78 @@ static int vc4_plane_set_blank(struct drm_plane *plane, bool blank)
 							"primary",
 							"cursor"
 						  };
-	int ret;
 
 	DRM_DEBUG_ATOMIC("[PLANE:%d:%s] %s plane %s",
 			 plane->base.id, plane->name, plane_types[plane->type],
 			 blank ? "blank" : "unblank");
 
-	if (blank)
-		ret = rpi_firmware_property_list(vc4->firmware, &blank_mb,
-						 sizeof(blank_mb));
-	else
-		ret = rpi_firmware_property_list(vc4->firmware, &vc4_plane->mb,
-						 sizeof(vc4_plane->mb));
+	*mb = blank ? blank_mb : vc4_plane->mb;
+}
+
+static int vc4_plane_set_blank(struct drm_plane *plane, bool blank)
+{
+	struct vc4_dev *vc4 = to_vc4_dev(plane->dev);
+	struct mailbox_set_plane mb;
+	int ret;
+
+	vc4_plane_get_blank_mb(plane, blank, &mb);
+
+	ret = rpi_firmware_property_list(vc4->firmware, &mb, sizeof(mb));
 
 	WARN_ONCE(ret, "%s: firmware call failed. Please update your firmware",
 		  __func__);
 	return ret;
 }
 
+/*
+ * Queue the blank/unblank of @plane on @crtc, to be sent together with
+ * the other planes of the commit from vc4_crtc_atomic_flush().  A plane
+ * that is already queued has its tag replaced, so that only its latest
+ * state is sent.
+ */
+static void vc4_plane_queue_blank(struct drm_plane *plane,
+				  struct drm_crtc *crtc, bool blank)
+{
+	struct vc4_crtc *vc4_crtc = to_vc4_crtc(crtc);
+	struct vc4_fkms_plane *vc4_plane = to_vc4_fkms_plane(plane);
+	unsigned int i;
+
+	for (i = 0; i < vc4_crtc->num_pending_planes; i++) {
+		if (vc4_crtc->pending_planes[i].plane.plane_id ==
+		    vc4_plane->mb.plane.plane_id)
+			break;
+	}
+
+	if (i == vc4_crtc->num_pending_planes) {
+		if (WARN_ON(i >= PLANES_PER_CRTC)) {
+			vc4_plane_set_blank(plane, blank);
+			return;
+		}
+		vc4_crtc->num_pending_planes++;
+	}
+
+	vc4_plane_get_blank_mb(plane, blank, &vc4_crtc->pending_planes[i]);
+}
+
+/* Send the queued SET_PLANE tags of @crtc in one mailbox round trip. */
+static void vc4_crtc_send_pending_planes(struct drm_crtc *crtc)
+{
+	struct vc4_crtc *vc4_crtc = to_vc4_crtc(crtc);
+	struct vc4_dev *vc4 = to_vc4_dev(crtc->dev);
+	int ret;
+
+	if (!vc4_crtc->num_pending_planes)
+		return;
+
+	ret = rpi_firmware_property_list(vc4->firmware,
+					 vc4_crtc->pending_planes,
+					 vc4_crtc->num_pending_planes *
+					 sizeof(vc4_crtc->pending_planes[0]));
+	WARN_ONCE(ret, "%s: firmware call failed. Please update your firmware",
+		  __func__);
+	vc4_crtc->num_pending_planes = 0;
+}
+
 static void vc4_fkms_crtc_get_margins(struct drm_crtc_state *state,
 				      unsigned int *left, unsigned int *right,
 				      unsigned int *top, unsigned int *bottom)
@@ -492,7 +555,7 @@ static void vc4_plane_atomic_update(struct drm_plane *plane,
 	 * then unblank.  Otherwise, stay blank until CRTC enable.
 	 */
 	if (state->crtc->state->active)
-		vc4_plane_set_blank(plane, false);
+		vc4_plane_queue_blank(plane, state->crtc, false);
 }
 
 static void vc4_plane_atomic_disable(struct drm_plane *plane,
@@ -508,7 +571,7 @@ static void vc4_plane_atomic_disable(struct drm_plane *plane,
 			 vc4_plane->mb.plane.vc_image_type,
 			 state->crtc_x,
 			 state->crtc_y);
-	vc4_plane_set_blank(plane, true);
+	vc4_plane_queue_blank(plane, old_state->crtc, true);
 }
 
 static bool plane_enabled(struct drm_plane_state *state)
@@ -999,7 +1062,10 @@ static void vc4_crtc_disable(struct drm_crtc *crtc,
 	 */
 
 	drm_atomic_crtc_for_each_plane(plane, crtc)
-		vc4_plane_atomic_disable(plane, plane->state);
+		vc4_plane_queue_blank(plane, crtc, true);
+
+	/* The blanks must reach the firmware before the event is sent. */
+	vc4_crtc_send_pending_planes(crtc);
 
 	/*
 	 * Make sure we issue a vblank event after disabling the CRTC if
@@ -1139,6 +1205,9 @@ static void vc4_crtc_atomic_flush(struct drm_crtc *crtc,
 
 	DRM_DEBUG_KMS("[CRTC:%d] crtc_atomic_flush.\n",
 		      crtc->base.id);
+
+	/* Update all the planes of this commit in one mailbox round trip */
+	vc4_crtc_send_pending_planes(crtc);
 	if (crtc->state->active && old_state->active && crtc->state->event)
 		vc4_crtc_consume_event(crtc);
 }
@@ -485,6 +485,7 @@ vc4_submit_next_bin_job(struct drm_device *dev)
 	 * immediately move it to the to-be-rendered queue.
 	 */
 	if (exec->ct0ca != exec->ct0ea) {
+		trace_vc4_bin_job_begin(dev, exec->seqno);
 		submit_cl(dev, 0, exec->ct0ca, exec->ct0ea);
 	} else {
 		struct vc4_exec_info *next;
@@ -519,6 +520,7 @@ vc4_submit_next_render_job(struct drm_device *dev)
 	 */
 	vc4_flush_texture_caches(dev);
 
+	trace_vc4_render_job_begin(dev, exec->seqno);
 	submit_cl(dev, 1, exec->ct1ca, exec->ct1ea);
 }
 
@@ -680,6 +682,7 @@ vc4_queue_submit(struct drm_device *dev, struct vc4_exec_info *exec,
 
 	seqno = ++vc4->emit_seqno;
 	exec->seqno = seqno;
+	trace_vc4_submit_cl(dev, seqno);
 
 	dma_fence_init(&fence->base, &vc4_fence_ops, &vc4->job_lock,
 		       vc4->dma_fence_context, exec->seqno);
@@ -817,13 +820,52 @@ vc4_cl_lookup_bos(struct drm_device *dev,
 	return ret;
 }
 
+/* Returns storage for copying in a job's command lists, reusing the file's
+ * scratch buffer where possible so that back to back submissions don't
+ * pay for a kvmalloc()/kvfree() pair each.
+ */
+static void *
+vc4_bcl_temp_get(struct vc4_file *vc4file, size_t size)
+{
+	if (size > VC4_BCL_SCRATCH_MAX || !mutex_trylock(&vc4file->bcl.lock))
+		return kvmalloc(size, GFP_KERNEL);
+
+	if (vc4file->bcl.size < size) {
+		kvfree(vc4file->bcl.scratch);
+		vc4file->bcl.size = 0;
+		vc4file->bcl.scratch = kvmalloc(max_t(size_t, size, PAGE_SIZE),
+						GFP_KERNEL);
+		if (!vc4file->bcl.scratch) {
+			mutex_unlock(&vc4file->bcl.lock);
+			return NULL;
+		}
+		vc4file->bcl.size = max_t(size_t, size, PAGE_SIZE);
+	}
+
+	return vc4file->bcl.scratch;
+}
+
+static void
+vc4_bcl_temp_put(struct vc4_file *vc4file, void *temp)
+{
+	if (!temp)
+		return;
+
+	if (temp == vc4file->bcl.scratch)
+		mutex_unlock(&vc4file->bcl.lock);
+	else
+		kvfree(temp);
+}
+
 static int
-vc4_get_bcl(struct drm_device *dev, struct vc4_exec_info *exec)
+vc4_get_bcl(struct drm_device *dev, struct vc4_file *vc4file,
+	    struct vc4_exec_info *exec)
 {
 	struct drm_vc4_submit_cl *args = exec->args;
 	struct vc4_dev *vc4 = to_vc4_dev(dev);
 	void *temp = NULL;
 	void *bin;
+	ktime_t start;
 	int ret = 0;
 	uint32_t bin_offset = 0;
 	uint32_t shader_rec_offset = roundup(bin_offset + args->bin_cl_size,
@@ -850,9 +892,11 @@ vc4_get_bcl(struct drm_device *dev, struct vc4_exec_info *exec)
 	 *
 	 * We don't just copy directly into the BOs because we need to
 	 * read the contents back for validation, and I think the
-	 * bo->vaddr is uncached access.
+	 * bo->vaddr is uncached access.  Validating in place in a buffer
+	 * userspace can still write to isn't an option either, as it could
+	 * change the contents after they've been checked.
 	 */
-	temp = kvmalloc_array(temp_size, 1, GFP_KERNEL);
+	temp = vc4_bcl_temp_get(vc4file, temp_size);
 	if (!temp) {
 		DRM_ERROR("Failed to allocate storage for copying "
 			  "in bin/render CLs.\n");
@@ -909,6 +953,8 @@ vc4_get_bcl(struct drm_device *dev, struct vc4_exec_info *exec)
 	exec->uniforms_p = exec->exec_bo->paddr + uniforms_offset;
 	exec->uniforms_size = args->uniforms_size;
 
+	start = ktime_get();
+
 	ret = vc4_validate_bin_cl(dev,
 				  exec->exec_bo->vaddr + bin_offset,
 				  bin,
@@ -920,6 +966,16 @@ vc4_get_bcl(struct drm_device *dev, struct vc4_exec_info *exec)
 	if (ret)
 		goto fail;
 
+	vc4_validation_stats_add_job(vc4, start);
+
+	/* The copied in state isn't needed beyond validation. */
+	vc4_bcl_temp_put(vc4file, temp);
+	temp = NULL;
+	exec->bin_u = NULL;
+	exec->shader_rec_u = NULL;
+	exec->uniforms_u = NULL;
+	exec->shader_state = NULL;
+
 	if (exec->found_tile_binning_mode_config_packet) {
 		ret = vc4_v3d_bin_bo_get(vc4, &exec->bin_bo_used);
 		if (ret)
@@ -933,7 +989,7 @@ vc4_get_bcl(struct drm_device *dev, struct vc4_exec_info *exec)
 	ret = vc4_wait_for_seqno(dev, exec->bin_dep_seqno, ~0ull, true);
 
 fail:
-	kvfree(temp);
+	vc4_bcl_temp_put(vc4file, temp);
 	return ret;
 }
 
@@ -1206,7 +1262,7 @@ vc4_submit_cl_ioctl(struct drm_device *dev, void *data,
 	}
 
 	if (exec->args->bin_cl_size != 0) {
-		ret = vc4_get_bcl(dev, exec);
+		ret = vc4_get_bcl(dev, vc4file, exec);
 		if (ret)
 			goto fail;
 	} else {
@@ -1286,6 +1342,8 @@ int vc4_gem_init(struct drm_device *dev)
 	INIT_LIST_HEAD(&vc4->purgeable.list);
 	mutex_init(&vc4->purgeable.lock);
 
+	spin_lock_init(&vc4->validation_stats.lock);
+
 	return drmm_add_action_or_reset(dev, vc4_gem_destroy, NULL);
 }
 
@@ -105,6 +105,10 @@ static int vc4_hvs_debugfs_dlist(struct seq_file *m, void *data)
 	unsigned int i, j;
 	u32 dlist_word, dispstat;
 
+	drm_printf(&p, "dlist words written: %lld, skipped: %lld\n",
+		   (long long)atomic64_read(&vc4->hvs->dlist_words_written),
+		   (long long)atomic64_read(&vc4->hvs->dlist_words_skipped));
+
 	for (i = 0; i < SCALER_CHANNELS_COUNT; i++) {
 		dispstat = VC4_GET_FIELD(HVS_READ(SCALER_DISPSTATX(i)),
 					 SCALER_DISPSTATX_MODE);
@@ -301,6 +305,7 @@ static int vc4_hvs_init_channel(struct vc4_dev *vc4, struct drm_crtc *crtc,
 	HVS_WRITE(SCALER_DISPCTRLX(chan), 0);
 	HVS_WRITE(SCALER_DISPCTRLX(chan), SCALER_DISPCTRLX_RESET);
 	HVS_WRITE(SCALER_DISPCTRLX(chan), 0);
+	vc4_hvs_invalidate_dlist_shadow(vc4->hvs);
 
 	/* Turn on the scaler, which will wait for vstart to start
 	 * compositing.
@@ -352,6 +357,7 @@ void vc4_hvs_stop_channel(struct drm_device *dev, unsigned int chan)
 		  HVS_READ(SCALER_DISPCTRLX(chan)) | SCALER_DISPCTRLX_RESET);
 	HVS_WRITE(SCALER_DISPCTRLX(chan),
 		  HVS_READ(SCALER_DISPCTRLX(chan)) & ~SCALER_DISPCTRLX_ENABLE);
+	vc4_hvs_invalidate_dlist_shadow(vc4->hvs);
 
 	/* Once we leave, the scaler should be disabled and its fifo empty. */
 	WARN_ON_ONCE(HVS_READ(SCALER_DISPCTRLX(chan)) & SCALER_DISPCTRLX_RESET);
@@ -365,6 +371,70 @@ void vc4_hvs_stop_channel(struct drm_device *dev, unsigned int chan)
 		     SCALER_DISPSTATX_EMPTY);
 }
 
+/**
+ * vc4_hvs_write_dlist() - Copies display list words to the HVS.
+ * @hvs: HVS the display list memory belongs to
+ * @dst: Destination in the HVS display list memory
+ * @src: CPU copy of the words to write
+ * @count: Number of words to write
+ *
+ * Words that already hold the value being written are skipped, apart
+ * from context words: the HVS overwrites those while scanning out, so
+ * the placeholder has to be written back each time.
+ */
+void vc4_hvs_write_dlist(struct vc4_hvs *hvs, u32 __iomem *dst,
+			 const u32 *src, unsigned int count)
+{
+	unsigned int offset = dst - hvs->dlist;
+	u32 *shadow = &hvs->dlist_shadow[offset];
+	unsigned int i, written = 0;
+
+	/* Can't memcpy_toio() because it needs to be 32-bit writes. */
+	for (i = 0; i < count; i++) {
+		if (shadow[i] == src[i] && src[i] != VC4_DLIST_CONTEXT_WORD &&
+		    test_bit(offset + i, hvs->dlist_shadow_valid))
+			continue;
+
+		writel(src[i], &dst[i]);
+		shadow[i] = src[i];
+		set_bit(offset + i, hvs->dlist_shadow_valid);
+		written++;
+	}
+
+	atomic64_add(written, &hvs->dlist_words_written);
+	atomic64_add(count - written, &hvs->dlist_words_skipped);
+}
+
+/**
+ * vc4_hvs_write_dlist_word() - Writes a single display list word.
+ * @hvs: HVS the display list memory belongs to
+ * @dst: Destination in the HVS display list memory
+ * @val: Value to write
+ *
+ * Unlike vc4_hvs_write_dlist(), this always writes, and is meant for
+ * updating a display list the HVS may currently be scanning out.
+ */
+void vc4_hvs_write_dlist_word(struct vc4_hvs *hvs, u32 __iomem *dst, u32 val)
+{
+	writel(val, dst);
+	hvs->dlist_shadow[dst - hvs->dlist] = val;
+	set_bit(dst - hvs->dlist, hvs->dlist_shadow_valid);
+	atomic64_inc(&hvs->dlist_words_written);
+}
+
+/**
+ * vc4_hvs_invalidate_dlist_shadow() - Forgets the display list shadow.
+ * @hvs: HVS the display list memory belongs to
+ *
+ * Called whenever an HVS channel is reset, after which the shadow can't
+ * be assumed to match the display list memory any more.  Every word is
+ * written out again the next time it's used.
+ */
+void vc4_hvs_invalidate_dlist_shadow(struct vc4_hvs *hvs)
+{
+	bitmap_zero(hvs->dlist_shadow_valid, SCALER_DLIST_SIZE >> 2);
+}
+
 int vc4_hvs_atomic_check(struct drm_crtc *crtc,
 			 struct drm_crtc_state *state)
 {
@@ -493,7 +563,7 @@ void vc4_hvs_atomic_flush(struct drm_crtc *crtc,
 		dlist_next += vc4_plane_write_dlist(plane, dlist_next);
 	}
 
-	writel(SCALER_CTL0_END, dlist_next);
+	vc4_hvs_write_dlist_word(vc4->hvs, dlist_next, SCALER_CTL0_END);
 	dlist_next++;
 
 	WARN_ON_ONCE(dlist_next - dlist_start != vc4_state->mm.size);
@@ -605,6 +675,7 @@ static int vc4_hvs_bind(struct device *dev, struct device *master, void *data)
 	struct drm_device *drm = dev_get_drvdata(master);
 	struct vc4_dev *vc4 = to_vc4_dev(drm);
 	struct vc4_hvs *hvs = NULL;
+	unsigned int i;
 	int ret;
 	u32 dispctrl;
 
@@ -676,6 +747,22 @@ static int vc4_hvs_bind(struct device *dev, struct device *master, void *data)
 	if (ret)
 		return ret;
 
+	/* Seed the shadow copy with whatever is in the display list
+	 * memory now, which includes the bootloader's setup and the
+	 * filter kernel.
+	 */
+	hvs->dlist_shadow = devm_kmalloc_array(&pdev->dev,
+					       SCALER_DLIST_SIZE >> 2,
+					       sizeof(u32), GFP_KERNEL);
+	hvs->dlist_shadow_valid =
+		devm_kcalloc(&pdev->dev, BITS_TO_LONGS(SCALER_DLIST_SIZE >> 2),
+			     sizeof(unsigned long), GFP_KERNEL);
+	if (!hvs->dlist_shadow || !hvs->dlist_shadow_valid)
+		return -ENOMEM;
+	for (i = 0; i < SCALER_DLIST_SIZE >> 2; i++)
+		hvs->dlist_shadow[i] = readl(hvs->dlist + i);
+	bitmap_fill(hvs->dlist_shadow_valid, SCALER_DLIST_SIZE >> 2);
+
 	vc4->hvs = hvs;
 
 	dispctrl = HVS_READ(SCALER_DISPCTRL);
@@ -512,7 +512,7 @@ static void vc4_write_scaling_parameters(struct drm_plane_state *state,
 	if (vc4_state->y_scaling[channel] == VC4_SCALING_PPF) {
 		vc4_write_ppf(vc4_state,
 			      vc4_state->src_h[channel], vc4_state->crtc_h);
-		vc4_dlist_write(vc4_state, 0xc0c0c0c0);
+		vc4_dlist_write(vc4_state, VC4_DLIST_CONTEXT_WORD);
 	}
 
 	/* Ch0 H-TPZ Words 0-1: Scaling Parameters, Recip */
@@ -525,7 +525,7 @@ static void vc4_write_scaling_parameters(struct drm_plane_state *state,
 	if (vc4_state->y_scaling[channel] == VC4_SCALING_TPZ) {
 		vc4_write_tpz(vc4_state,
 			      vc4_state->src_h[channel], vc4_state->crtc_h);
-		vc4_dlist_write(vc4_state, 0xc0c0c0c0);
+		vc4_dlist_write(vc4_state, VC4_DLIST_CONTEXT_WORD);
 	}
 }
 
@@ -940,7 +940,7 @@ static int vc4_plane_mode_set(struct drm_plane *plane,
 					      SCALER_POS2_HEIGHT));
 
 		/* Position Word 3: Context.  Written by the HVS. */
-		vc4_dlist_write(vc4_state, 0xc0c0c0c0);
+		vc4_dlist_write(vc4_state, VC4_DLIST_CONTEXT_WORD);
 
 	} else {
 		u32 hvs_pixel_order = format->pixel_order;
@@ -1006,7 +1006,7 @@ static int vc4_plane_mode_set(struct drm_plane *plane,
 					      SCALER5_POS2_HEIGHT));
 
 		/* Position Word 3: Context.  Written by the HVS. */
-		vc4_dlist_write(vc4_state, 0xc0c0c0c0);
+		vc4_dlist_write(vc4_state, VC4_DLIST_CONTEXT_WORD);
 	}
 
 
@@ -1020,7 +1020,7 @@ static int vc4_plane_mode_set(struct drm_plane *plane,
 
 	/* Pointer Context Word 0/1/2: Written by the HVS */
 	for (i = 0; i < num_planes; i++)
-		vc4_dlist_write(vc4_state, 0xc0c0c0c0);
+		vc4_dlist_write(vc4_state, VC4_DLIST_CONTEXT_WORD);
 
 	/* Pitch word 0 */
 	vc4_dlist_write(vc4_state, pitch0);
@@ -1164,13 +1164,12 @@ static void vc4_plane_atomic_update(struct drm_plane *plane,
 u32 vc4_plane_write_dlist(struct drm_plane *plane, u32 __iomem *dlist)
 {
 	struct vc4_plane_state *vc4_state = to_vc4_plane_state(plane->state);
-	int i;
+	struct vc4_dev *vc4 = to_vc4_dev(plane->dev);
 
 	vc4_state->hw_dlist = dlist;
 
-	/* Can't memcpy_toio() because it needs to be 32-bit writes. */
-	for (i = 0; i < vc4_state->dlist_count; i++)
-		writel(vc4_state->dlist[i], &dlist[i]);
+	vc4_hvs_write_dlist(vc4->hvs, dlist, vc4_state->dlist,
+			    vc4_state->dlist_count);
 
 	return vc4_state->dlist_count;
 }
@@ -1190,6 +1189,7 @@ void vc4_plane_async_set_fb(struct drm_plane *plane, struct drm_framebuffer *fb)
 {
 	struct vc4_plane_state *vc4_state = to_vc4_plane_state(plane->state);
 	struct drm_gem_cma_object *bo = drm_fb_cma_get_gem_obj(fb, 0);
+	struct vc4_dev *vc4 = to_vc4_dev(plane->dev);
 	uint32_t addr;
 
 	/* We're skipping the address adjustment for negative origin,
@@ -1202,7 +1202,9 @@ void vc4_plane_async_set_fb(struct drm_plane *plane, struct drm_framebuffer *fb)
 	 * scanout will start from this address as soon as the FIFO
 	 * needs to refill with pixels.
 	 */
-	writel(addr, &vc4_state->hw_dlist[vc4_state->ptr0_offset]);
+	vc4_hvs_write_dlist_word(vc4->hvs,
+				 &vc4_state->hw_dlist[vc4_state->ptr0_offset],
+				 addr);
 
 	/* Also update the CPU-side dlist copy, so that any later
 	 * atomic updates that don't do a new modeset on our plane
@@ -1214,6 +1216,7 @@ void vc4_plane_async_set_fb(struct drm_plane *plane, struct drm_framebuffer *fb)
 static void vc4_plane_atomic_async_update(struct drm_plane *plane,
 					  struct drm_plane_state *state)
 {
+	struct vc4_dev *vc4 = to_vc4_dev(plane->dev);
 	struct vc4_plane_state *vc4_state, *new_vc4_state;
 
 	swap(plane->state->fb, state->fb);
@@ -1272,12 +1275,15 @@ static void vc4_plane_atomic_async_update(struct drm_plane *plane,
 	 * because that would smash the context data that the HVS is
 	 * currently using.
 	 */
-	writel(vc4_state->dlist[vc4_state->pos0_offset],
-	       &vc4_state->hw_dlist[vc4_state->pos0_offset]);
-	writel(vc4_state->dlist[vc4_state->pos2_offset],
-	       &vc4_state->hw_dlist[vc4_state->pos2_offset]);
-	writel(vc4_state->dlist[vc4_state->ptr0_offset],
-	       &vc4_state->hw_dlist[vc4_state->ptr0_offset]);
+	vc4_hvs_write_dlist_word(vc4->hvs,
+				 &vc4_state->hw_dlist[vc4_state->pos0_offset],
+				 vc4_state->dlist[vc4_state->pos0_offset]);
+	vc4_hvs_write_dlist_word(vc4->hvs,
+				 &vc4_state->hw_dlist[vc4_state->pos2_offset],
+				 vc4_state->dlist[vc4_state->pos2_offset]);
+	vc4_hvs_write_dlist_word(vc4->hvs,
+				 &vc4_state->hw_dlist[vc4_state->ptr0_offset],
+				 vc4_state->dlist[vc4_state->ptr0_offset]);
 }
 
 static int vc4_plane_atomic_async_check(struct drm_plane *plane,
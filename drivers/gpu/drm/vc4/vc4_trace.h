@@ -52,6 +52,54 @@ TRACE_EVENT(vc4_wait_for_seqno_end,
 		      __entry->dev, __entry->seqno)
 );
 
+/*
+ * Job lifecycle events. vc4_submit_cl is emitted from the submitting
+ * process's context, so its pid together with the seqno attributes the
+ * bin/render begin and end events that follow to that process.
+ */
+DECLARE_EVENT_CLASS(vc4_job,
+	    TP_PROTO(struct drm_device *dev, uint64_t seqno),
+	    TP_ARGS(dev, seqno),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u64, seqno)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = dev->primary->index;
+			   __entry->seqno = seqno;
+			   ),
+
+	    TP_printk("dev=%u, seqno=%llu",
+		      __entry->dev, __entry->seqno)
+);
+
+DEFINE_EVENT(vc4_job, vc4_submit_cl,
+	    TP_PROTO(struct drm_device *dev, uint64_t seqno),
+	    TP_ARGS(dev, seqno)
+);
+
+DEFINE_EVENT(vc4_job, vc4_bin_job_begin,
+	    TP_PROTO(struct drm_device *dev, uint64_t seqno),
+	    TP_ARGS(dev, seqno)
+);
+
+DEFINE_EVENT(vc4_job, vc4_bin_job_end,
+	    TP_PROTO(struct drm_device *dev, uint64_t seqno),
+	    TP_ARGS(dev, seqno)
+);
+
+DEFINE_EVENT(vc4_job, vc4_render_job_begin,
+	    TP_PROTO(struct drm_device *dev, uint64_t seqno),
+	    TP_ARGS(dev, seqno)
+);
+
+DEFINE_EVENT(vc4_job, vc4_render_job_end,
+	    TP_PROTO(struct drm_device *dev, uint64_t seqno),
+	    TP_ARGS(dev, seqno)
+);
+
 #endif /* _VC4_TRACE_H_ */
 
 /* This part must be outside protection */
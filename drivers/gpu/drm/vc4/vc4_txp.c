@@ -211,6 +211,8 @@ static const u32 drm_fmts[] = {
 	DRM_FORMAT_BGRX8888,
 	DRM_FORMAT_RGBA8888,
 	DRM_FORMAT_BGRA8888,
+	DRM_FORMAT_RGB565,
+	DRM_FORMAT_BGR565,
 };
 
 static const u32 txp_fmts[] = {
@@ -224,6 +226,8 @@ static const u32 txp_fmts[] = {
 	TXP_FORMAT_BGRA8888,
 	TXP_FORMAT_RGBA8888,
 	TXP_FORMAT_BGRA8888,
+	TXP_FORMAT_RGB565,
+	TXP_FORMAT_BGR565,
 };
 
 static void vc4_txp_armed(struct drm_crtc_state *state)
@@ -6,6 +6,7 @@
  *
  * Copyright (C) 2018 Stefan Wahren <stefan.wahren@i2se.com>
  */
+#include <linux/completion.h>
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/hwmon.h>
@@ -52,22 +53,24 @@ struct rpi_hwmon_data {
 	struct rpi_firmware *fw;
 	u32 last_throttled;
 	struct delayed_work get_values_poll_work;
+
+	/* Queued RPI_FIRMWARE_GET_THROTTLED request and its answer */
+	struct rpi_firmware_async_tag throttled_req;
+	u32 throttled_value;
+	struct completion throttled_done;
 };
 
-static void rpi_firmware_get_throttled(struct rpi_hwmon_data *data)
+static void rpi_firmware_throttled_complete(struct rpi_firmware_async_tag *req,
+					    int ret)
 {
-	u32 new_uv, old_uv, value;
-	int ret;
+	struct rpi_hwmon_data *data = container_of(req, struct rpi_hwmon_data,
+						   throttled_req);
+	u32 new_uv, old_uv, value = data->throttled_value;
 
-	/* Request firmware to clear sticky bits */
-	value = 0xffff;
-
-	ret = rpi_firmware_property(data->fw, RPI_FIRMWARE_GET_THROTTLED,
-				    &value, sizeof(value));
 	if (ret) {
 		dev_err_once(data->hwmon_dev, "Failed to get throttled (%d)\n",
 			     ret);
-		return;
+		goto out;
 	}
 
 	new_uv = value & UNDERVOLTAGE_STICKY_BIT;
@@ -75,7 +78,7 @@ static void rpi_firmware_get_throttled(struct rpi_hwmon_data *data)
 	data->last_throttled = value;
 
 	if (new_uv == old_uv)
-		return;
+		goto out;
 
 	if (new_uv) {
 		pr_crit_ratelimited_local("Under-voltage detected! (0x%08x)\n",
@@ -86,6 +89,30 @@ static void rpi_firmware_get_throttled(struct rpi_hwmon_data *data)
 	}
 
 	sysfs_notify(&data->hwmon_dev->kobj, NULL, "in0_lcrit_alarm");
+out:
+	complete(&data->throttled_done);
+}
+
+static void rpi_firmware_get_throttled(struct rpi_hwmon_data *data)
+{
+	int ret;
+
+	/*
+	 * Queue the request rather than waiting for it, so the poll can
+	 * share a mailbox round trip with other firmware clients. Skip
+	 * this round if the previous answer is still outstanding.
+	 */
+	if (!completion_done(&data->throttled_done))
+		return;
+
+	reinit_completion(&data->throttled_done);
+
+	/* Request firmware to clear sticky bits */
+	data->throttled_value = 0xffff;
+
+	ret = rpi_firmware_property_queue(data->fw, &data->throttled_req);
+	if (ret)
+		rpi_firmware_throttled_complete(&data->throttled_req, ret);
 }
 
 static void get_values_poll(struct work_struct *work)
@@ -147,6 +174,13 @@ static int rpi_hwmon_probe(struct platform_device *pdev)
 	/* Parent driver assure that firmware is correct */
 	data->fw = dev_get_drvdata(dev->parent);
 
+	data->throttled_req.tag = RPI_FIRMWARE_GET_THROTTLED;
+	data->throttled_req.data = &data->throttled_value;
+	data->throttled_req.buf_size = sizeof(data->throttled_value);
+	data->throttled_req.complete = rpi_firmware_throttled_complete;
+	init_completion(&data->throttled_done);
+	complete(&data->throttled_done);
+
 	data->hwmon_dev = devm_hwmon_device_register_with_info(dev, "rpi_volt",
 							       data,
 							       &rpi_chip_info,
@@ -166,6 +200,7 @@ static int rpi_hwmon_remove(struct platform_device *pdev)
 	struct rpi_hwmon_data *data = platform_get_drvdata(pdev);
 
 	cancel_delayed_work_sync(&data->get_values_poll_work);
+	wait_for_completion(&data->throttled_done);
 
 	return 0;
 }
@@ -48,6 +48,8 @@
 #define BCM2835_I2C_FEDL_SHIFT	16
 #define BCM2835_I2C_REDL_SHIFT	0
 
+#define BCM2835_I2C_FIFO_SIZE	16
+
 #define BCM2835_I2C_CDIV_MIN	0x0002
 #define BCM2835_I2C_CDIV_MAX	0xFFFE
 
@@ -320,6 +322,10 @@ static void bcm2835_drain_rxfifo(struct bcm2835_i2c_dev *i2c_dev)
  * a problem in the state machine.
  * It turns out that it is possible to use the TXW interrupt to know when the
  * transfer is active, provided the FIFO has not been prefilled.
+ *
+ * No Sr follows the last message, so a final write that fits in the FIFO is
+ * prefilled instead and completes on the DONE interrupt alone.  This halves
+ * the interrupts taken by register-at-a-time writes such as sensor tables.
  */
 
 static void bcm2835_i2c_start_transfer(struct bcm2835_i2c_dev *i2c_dev)
@@ -335,9 +341,14 @@ static void bcm2835_i2c_start_transfer(struct bcm2835_i2c_dev *i2c_dev)
 	i2c_dev->msg_buf = msg->buf;
 	i2c_dev->msg_buf_remaining = msg->len;
 
+	/*
+	 * Only prefill when idle; when chained from the ISR the FIFO may
+	 * still hold the tail of the previous message.
+	 */
 	if (msg->flags & I2C_M_RD)
 		c |= BCM2835_I2C_C_READ | BCM2835_I2C_C_INTR;
-	else
+	else if (!last_msg || msg->len > BCM2835_I2C_FIFO_SIZE ||
+		 (bcm2835_i2c_readl(i2c_dev, BCM2835_I2C_S) & BCM2835_I2C_S_TA))
 		c |= BCM2835_I2C_C_INTT;
 
 	if (last_msg)
@@ -345,6 +356,8 @@ static void bcm2835_i2c_start_transfer(struct bcm2835_i2c_dev *i2c_dev)
 
 	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_A, msg->addr);
 	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_DLEN, msg->len);
+	if (!(c & (BCM2835_I2C_C_READ | BCM2835_I2C_C_INTT)))
+		bcm2835_fill_txfifo(i2c_dev);
 	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_C, c);
 	bcm2835_debug_add(i2c_dev, ~0);
 }
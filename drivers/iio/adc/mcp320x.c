@@ -42,7 +42,11 @@
 #include <linux/spi/spi.h>
 #include <linux/module.h>
 #include <linux/mod_devicetable.h>
+#include <linux/interrupt.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/regulator/consumer.h>
 
 enum {
@@ -61,9 +65,12 @@ enum {
 	mcp3553,
 };
 
+/* the most channels a scan can have: 8 single-ended plus 8 differential */
+#define MCP320X_MAX_SCAN_CHANNELS	16
+
 struct mcp320x_chip_info {
 	const struct iio_chan_spec *channels;
-	unsigned int num_channels;
+	unsigned int num_channels;	/* not counting the timestamp */
 	unsigned int resolution;
 	unsigned int conv_time; /* usec */
 };
@@ -78,6 +85,7 @@ struct mcp320x_chip_info {
  * @reg: regulator generating Vref
  * @lock: protects read sequences
  * @chip_info: ADC properties
+ * @scan: buffer for one scan pushed from the trigger handler
  * @tx_buf: buffer for @transfer[0] (not used on single-channel converters)
  * @rx_buf: buffer for @transfer[1]
  */
@@ -92,6 +100,11 @@ struct mcp320x {
 	struct mutex lock;
 	const struct mcp320x_chip_info *chip_info;
 
+	struct {
+		s32 data[MCP320X_MAX_SCAN_CHANNELS];
+		s64 ts __aligned(8);
+	} scan;
+
 	u8 tx_buf ____cacheline_aligned;
 	u8 rx_buf[4];
 };
@@ -231,6 +244,19 @@ static int mcp320x_read_raw(struct iio_dev *indio_dev,
 	return ret;
 }
 
+/*
+ * Buffered samples are the same values read_raw() returns, already
+ * shifted and sign extended, so every chip can use one scan type.
+ * scan_index must match the position in the channel array.
+ */
+#define MCP320X_SCAN_TYPE					\
+	{							\
+		.sign = 's',					\
+		.realbits = 32,					\
+		.storagebits = 32,				\
+		.endianness = IIO_CPU,				\
+	}
+
 #define MCP320X_VOLTAGE_CHANNEL(num)				\
 	{							\
 		.type = IIO_VOLTAGE,				\
@@ -238,10 +264,12 @@ static int mcp320x_read_raw(struct iio_dev *indio_dev,
 		.channel = (num),				\
 		.address = (num),				\
 		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),	\
-		.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) \
+		.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE), \
+		.scan_index = (num),				\
+		.scan_type = MCP320X_SCAN_TYPE,			\
 	}
 
-#define MCP320X_VOLTAGE_CHANNEL_DIFF(chan1, chan2)		\
+#define MCP320X_VOLTAGE_CHANNEL_DIFF(chan1, chan2, index)	\
 	{							\
 		.type = IIO_VOLTAGE,				\
 		.indexed = 1,					\
@@ -250,18 +278,22 @@ static int mcp320x_read_raw(struct iio_dev *indio_dev,
 		.address = (chan1),				\
 		.differential = 1,				\
 		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),	\
-		.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) \
+		.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE), \
+		.scan_index = (index),				\
+		.scan_type = MCP320X_SCAN_TYPE,			\
 	}
 
 static const struct iio_chan_spec mcp3201_channels[] = {
-	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1, 0),
+	IIO_CHAN_SOFT_TIMESTAMP(1),
 };
 
 static const struct iio_chan_spec mcp3202_channels[] = {
 	MCP320X_VOLTAGE_CHANNEL(0),
 	MCP320X_VOLTAGE_CHANNEL(1),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(1, 0),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1, 2),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(1, 0, 3),
+	IIO_CHAN_SOFT_TIMESTAMP(4),
 };
 
 static const struct iio_chan_spec mcp3204_channels[] = {
@@ -269,10 +301,11 @@ static const struct iio_chan_spec mcp3204_channels[] = {
 	MCP320X_VOLTAGE_CHANNEL(1),
 	MCP320X_VOLTAGE_CHANNEL(2),
 	MCP320X_VOLTAGE_CHANNEL(3),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(1, 0),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(2, 3),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(3, 2),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1, 4),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(1, 0, 5),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(2, 3, 6),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(3, 2, 7),
+	IIO_CHAN_SOFT_TIMESTAMP(8),
 };
 
 static const struct iio_chan_spec mcp3208_channels[] = {
@@ -284,16 +317,48 @@ static const struct iio_chan_spec mcp3208_channels[] = {
 	MCP320X_VOLTAGE_CHANNEL(5),
 	MCP320X_VOLTAGE_CHANNEL(6),
 	MCP320X_VOLTAGE_CHANNEL(7),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(1, 0),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(2, 3),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(3, 2),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(4, 5),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(5, 4),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(6, 7),
-	MCP320X_VOLTAGE_CHANNEL_DIFF(7, 6),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(0, 1, 8),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(1, 0, 9),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(2, 3, 10),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(3, 2, 11),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(4, 5, 12),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(5, 4, 13),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(6, 7, 14),
+	MCP320X_VOLTAGE_CHANNEL_DIFF(7, 6, 15),
+	IIO_CHAN_SOFT_TIMESTAMP(16),
 };
 
+static irqreturn_t mcp320x_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct mcp320x *adc = iio_priv(indio_dev);
+	const struct iio_chan_spec *chan;
+	int device_index = spi_get_device_id(adc->spi)->driver_data;
+	int bit, i = 0, ret;
+
+	mutex_lock(&adc->lock);
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 adc->chip_info->num_channels) {
+		chan = &indio_dev->channels[bit];
+		ret = mcp320x_adc_conversion(adc, chan->address,
+					     chan->differential, device_index,
+					     &adc->scan.data[i++]);
+		if (ret < 0)
+			goto out;
+	}
+
+	iio_push_to_buffers_with_timestamp(indio_dev, &adc->scan,
+					   iio_get_time_ns(indio_dev));
+
+out:
+	mutex_unlock(&adc->lock);
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static const struct iio_info mcp320x_info = {
 	.read_raw = mcp320x_read_raw,
 };
@@ -301,76 +366,83 @@ static const struct iio_info mcp320x_info = {
 static const struct mcp320x_chip_info mcp320x_chip_infos[] = {
 	[mcp3001] = {
 		.channels = mcp3201_channels,
-		.num_channels = ARRAY_SIZE(mcp3201_channels),
+		.num_channels = ARRAY_SIZE(mcp3201_channels) - 1,
 		.resolution = 10
 	},
 	[mcp3002] = {
 		.channels = mcp3202_channels,
-		.num_channels = ARRAY_SIZE(mcp3202_channels),
+		.num_channels = ARRAY_SIZE(mcp3202_channels) - 1,
 		.resolution = 10
 	},
 	[mcp3004] = {
 		.channels = mcp3204_channels,
-		.num_channels = ARRAY_SIZE(mcp3204_channels),
+		.num_channels = ARRAY_SIZE(mcp3204_channels) - 1,
 		.resolution = 10
 	},
 	[mcp3008] = {
 		.channels = mcp3208_channels,
-		.num_channels = ARRAY_SIZE(mcp3208_channels),
+		.num_channels = ARRAY_SIZE(mcp3208_channels) - 1,
 		.resolution = 10
 	},
 	[mcp3201] = {
 		.channels = mcp3201_channels,
-		.num_channels = ARRAY_SIZE(mcp3201_channels),
+		.num_channels = ARRAY_SIZE(mcp3201_channels) - 1,
 		.resolution = 12
 	},
 	[mcp3202] = {
 		.channels = mcp3202_channels,
-		.num_channels = ARRAY_SIZE(mcp3202_channels),
+		.num_channels = ARRAY_SIZE(mcp3202_channels) - 1,
 		.resolution = 12
 	},
 	[mcp3204] = {
 		.channels = mcp3204_channels,
-		.num_channels = ARRAY_SIZE(mcp3204_channels),
+		.num_channels = ARRAY_SIZE(mcp3204_channels) - 1,
 		.resolution = 12
 	},
 	[mcp3208] = {
 		.channels = mcp3208_channels,
-		.num_channels = ARRAY_SIZE(mcp3208_channels),
+		.num_channels = ARRAY_SIZE(mcp3208_channels) - 1,
 		.resolution = 12
 	},
 	[mcp3301] = {
 		.channels = mcp3201_channels,
-		.num_channels = ARRAY_SIZE(mcp3201_channels),
+		.num_channels = ARRAY_SIZE(mcp3201_channels) - 1,
 		.resolution = 13
 	},
 	[mcp3550_50] = {
 		.channels = mcp3201_channels,
-		.num_channels = ARRAY_SIZE(mcp3201_channels),
+		.num_channels = ARRAY_SIZE(mcp3201_channels) - 1,
 		.resolution = 21,
 		/* 2% max deviation + 144 clock periods to exit shutdown */
 		.conv_time = 80000 * 1.02 + 144000 / 102.4,
 	},
 	[mcp3550_60] = {
 		.channels = mcp3201_channels,
-		.num_channels = ARRAY_SIZE(mcp3201_channels),
+		.num_channels = ARRAY_SIZE(mcp3201_channels) - 1,
 		.resolution = 21,
 		.conv_time = 66670 * 1.02 + 144000 / 122.88,
 	},
 	[mcp3551] = {
 		.channels = mcp3201_channels,
-		.num_channels = ARRAY_SIZE(mcp3201_channels),
+		.num_channels = ARRAY_SIZE(mcp3201_channels) - 1,
 		.resolution = 21,
 		.conv_time = 73100 * 1.02 + 144000 / 112.64,
 	},
 	[mcp3553] = {
 		.channels = mcp3201_channels,
-		.num_channels = ARRAY_SIZE(mcp3201_channels),
+		.num_channels = ARRAY_SIZE(mcp3201_channels) - 1,
 		.resolution = 21,
 		.conv_time = 16670 * 1.02 + 144000 / 122.88,
 	},
 };
 
+static void mcp320x_regulator_disable(void *data)
+{
+	struct mcp320x *adc = data;
+
+	regulator_disable(adc->reg);
+}
+
 static int mcp320x_probe(struct spi_device *spi)
 {
 	struct iio_dev *indio_dev;
@@ -393,7 +465,7 @@ static int mcp320x_probe(struct spi_device *spi)
 	device_index = spi_get_device_id(spi)->driver_data;
 	chip_info = &mcp320x_chip_infos[device_index];
 	indio_dev->channels = chip_info->channels;
-	indio_dev->num_channels = chip_info->num_channels;
+	indio_dev->num_channels = chip_info->num_channels + 1; /* timestamp */
 
 	adc->chip_info = chip_info;
 
@@ -445,29 +517,19 @@ static int mcp320x_probe(struct spi_device *spi)
 	if (ret < 0)
 		return ret;
 
+	ret = devm_add_action_or_reset(&spi->dev, mcp320x_regulator_disable,
+				       adc);
+	if (ret)
+		return ret;
+
 	mutex_init(&adc->lock);
 
-	ret = iio_device_register(indio_dev);
+	ret = devm_iio_triggered_buffer_setup(&spi->dev, indio_dev, NULL,
+					      mcp320x_trigger_handler, NULL);
 	if (ret < 0)
-		goto reg_disable;
-
-	return 0;
-
-reg_disable:
-	regulator_disable(adc->reg);
-
-	return ret;
-}
-
-static int mcp320x_remove(struct spi_device *spi)
-{
-	struct iio_dev *indio_dev = spi_get_drvdata(spi);
-	struct mcp320x *adc = iio_priv(indio_dev);
-
-	iio_device_unregister(indio_dev);
-	regulator_disable(adc->reg);
+		return ret;
 
-	return 0;
+	return devm_iio_device_register(&spi->dev, indio_dev);
 }
 
 static const struct of_device_id mcp320x_dt_ids[] = {
@@ -522,7 +584,6 @@ static struct spi_driver mcp320x_driver = {
 		.of_match_table = mcp320x_dt_ids,
 	},
 	.probe = mcp320x_probe,
-	.remove = mcp320x_remove,
 	.id_table = mcp320x_id,
 };
 module_spi_driver(mcp320x_driver);
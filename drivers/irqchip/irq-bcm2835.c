@@ -36,6 +36,7 @@
  */
 
 #include <linux/io.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
@@ -152,23 +153,30 @@ static void armctrl_unmask_irq(struct irq_data *d)
 	}
 }
 
-#ifdef CONFIG_ARM64
+/*
+ * On BCM2836/7 every ARMCTRL interrupt reaches the cores through the one
+ * GPU interrupt, which the local intc routes to a single core. Moving
+ * that route to the next active core on each ack spreads peripheral
+ * interrupt load. 32-bit kernels, where the GPU FIQ may be in use,
+ * keep the fixed routing unless asked.
+ */
+static bool spin_gpu_irq = IS_ENABLED(CONFIG_ARM64);
+module_param(spin_gpu_irq, bool, 0444);
+MODULE_PARM_DESC(spin_gpu_irq, "Rotate the peripheral interrupt over all cores (BCM2836/7 only)");
+
 void bcm2836_arm_irqchip_spin_gpu_irq(void);
 
 static void armctrl_ack_irq(struct irq_data *d)
 {
-	bcm2836_arm_irqchip_spin_gpu_irq();
+	if (spin_gpu_irq)
+		bcm2836_arm_irqchip_spin_gpu_irq();
 }
 
-#endif
-
 static struct irq_chip armctrl_chip = {
 	.name = "ARMCTRL-level",
 	.irq_mask = armctrl_mask_irq,
 	.irq_unmask = armctrl_unmask_irq,
-#ifdef CONFIG_ARM64
 	.irq_ack    = armctrl_ack_irq
-#endif
 };
 
 static int armctrl_xlate(struct irq_domain *d, struct device_node *ctrlr,
@@ -252,6 +260,8 @@ static int __init armctrl_of_init(struct device_node *node,
 		}
 		irq_set_chained_handler(parent_irq, bcm2836_chained_handle_irq);
 	} else {
+		/* there is no local intc to route through */
+		spin_gpu_irq = false;
 		set_handle_irq(bcm2835_handle_irq);
 	}
 
@@ -87,8 +87,6 @@ static void bcm2836_arm_irqchip_unmask_gpu_irq(struct irq_data *d)
 {
 }
 
-#ifdef CONFIG_ARM64
-
 void bcm2836_arm_irqchip_spin_gpu_irq(void)
 {
 	u32 i;
@@ -96,18 +94,17 @@ void bcm2836_arm_irqchip_spin_gpu_irq(void)
 	u32 routing_val = readl(gpurouting);
 
 	for (i = 1; i <= 3; i++) {
-		u32 new_routing_val = (routing_val + i) & 3;
+		u32 new_cpu = (routing_val + i) & 3;
 
-		if (cpu_active(new_routing_val)) {
-			writel(new_routing_val, gpurouting);
+		/* only move the IRQ, leave the GPU FIQ where it is */
+		if (cpu_active(new_cpu)) {
+			writel((routing_val & ~3) | new_cpu, gpurouting);
 			return;
 		}
 	}
 }
 EXPORT_SYMBOL(bcm2836_arm_irqchip_spin_gpu_irq);
 
-#endif
-
 static struct irq_chip bcm2836_arm_irqchip_gpu = {
 	.name		= "bcm2836-gpu",
 	.irq_mask	= bcm2836_arm_irqchip_mask_gpu_irq,
@@ -136,6 +136,13 @@ static int verity_hash_init(struct dm_verity *v, struct ahash_request *req,
 					crypto_req_done, (void *)wait);
 	crypto_init_wait(wait);
 
+	if (likely(v->initial_hashstate)) {
+		r = crypto_ahash_import(req, v->initial_hashstate);
+		if (unlikely(r < 0))
+			DMERR("crypto_ahash_import failed: %d", r);
+		return r;
+	}
+
 	r = crypto_wait_req(crypto_ahash_init(req), wait);
 
 	if (unlikely(r < 0)) {
@@ -822,6 +829,7 @@ static void verity_dtr(struct dm_target *ti)
 	kfree(v->salt);
 	kfree(v->root_digest);
 	kfree(v->zero_digest);
+	kfree(v->initial_hashstate);
 
 	if (v->tfm)
 		crypto_free_ahash(v->tfm);
@@ -893,6 +901,46 @@ static int verity_alloc_zero_digest(struct dm_verity *v)
 	return r;
 }
 
+/*
+ * With a version 1 format the salt is hashed first for every block, so
+ * precompute the hash state after the salt once and import it per block.
+ * Not every ahash implementation supports export/import; those just keep
+ * hashing the salt each time.
+ */
+static int verity_alloc_initial_hashstate(struct dm_verity *v)
+{
+	struct ahash_request *req;
+	struct crypto_wait wait;
+	int r;
+
+	if (!v->salt_size || !v->version)
+		return 0;
+
+	req = kmalloc(v->ahash_reqsize, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	r = verity_hash_init(v, req, &wait);
+	if (r < 0)
+		goto out;
+
+	v->initial_hashstate = kmalloc(crypto_ahash_statesize(v->tfm),
+				       GFP_KERNEL);
+	if (!v->initial_hashstate) {
+		r = -ENOMEM;
+		goto out;
+	}
+
+	if (crypto_ahash_export(req, v->initial_hashstate)) {
+		kfree(v->initial_hashstate);
+		v->initial_hashstate = NULL;
+	}
+	r = 0;
+out:
+	kfree(req);
+	return r;
+}
+
 static int verity_parse_opt_args(struct dm_arg_set *as, struct dm_verity *v,
 				 struct dm_verity_sig_opts *verify_args)
 {
@@ -1141,6 +1189,12 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		}
 	}
 
+	r = verity_alloc_initial_hashstate(v);
+	if (r) {
+		ti->error = "Cannot compute initial hash state";
+		goto bad;
+	}
+
 	argv += 10;
 	argc -= 10;
 
@@ -410,6 +410,12 @@ struct unicam_node {
 	 */
 	void *dummy_buf_cpu_addr;
 	dma_addr_t dummy_buf_dma_addr;
+	/* Capture statistics since the last stream on, see log_status */
+	unsigned int frames;
+	unsigned int dropped_frames;
+	unsigned int late_scheduled;
+	u64 total_latency_ns;
+	u64 max_latency_ns;
 };
 
 struct unicam_device {
@@ -767,6 +773,13 @@ static void unicam_schedule_dummy_buffer(struct unicam_node *node)
 static void unicam_process_buffer_complete(struct unicam_node *node,
 					   unsigned int sequence)
 {
+	u64 latency = ktime_get_ns() - node->cur_frm->vb.vb2_buf.timestamp;
+
+	node->frames++;
+	node->total_latency_ns += latency;
+	if (latency > node->max_latency_ns)
+		node->max_latency_ns = latency;
+
 	node->cur_frm->vb.field = node->m_fmt.field;
 	node->cur_frm->vb.sequence = sequence;
 
@@ -831,10 +844,14 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 			if (!unicam->node[i].streaming)
 				continue;
 
+			spin_lock(&unicam->node[i].dma_queue_lock);
 			if (unicam->node[i].cur_frm)
 				unicam_process_buffer_complete(&unicam->node[i],
 							       sequence);
+			else
+				unicam->node[i].dropped_frames++;
 			unicam->node[i].cur_frm = unicam->node[i].next_frm;
+			spin_unlock(&unicam->node[i].dma_queue_lock);
 		}
 		unicam->sequence++;
 	}
@@ -849,6 +866,7 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 			if (!unicam->node[i].streaming)
 				continue;
 
+			spin_lock(&unicam->node[i].dma_queue_lock);
 			if (unicam->node[i].cur_frm)
 				unicam->node[i].cur_frm->vb.vb2_buf.timestamp =
 								ts;
@@ -858,6 +876,7 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 			 * from the queue.
 			 */
 			unicam_schedule_dummy_buffer(&unicam->node[i]);
+			spin_unlock(&unicam->node[i].dma_queue_lock);
 		}
 
 		unicam_queue_event_sof(unicam);
@@ -1310,6 +1329,21 @@ static void unicam_buffer_queue(struct vb2_buffer *vb)
 
 	spin_lock_irqsave(&node->dma_queue_lock, flags);
 	list_add_tail(&buf->list, &node->dma_queue);
+
+	/*
+	 * If the buffer arrives after the line interrupt has already
+	 * found the queue empty, the next frame would go to the dummy
+	 * buffer. Schedule it here instead, provided the current frame
+	 * is still well short of its end so that the address is written
+	 * before the hardware latches it at the next frame start.
+	 */
+	if (node->streaming && node->pad_id == IMAGE_PAD &&
+	    node->cur_frm && !node->next_frm &&
+	    unicam_get_lines_done(node->dev) <
+			(node->v_fmt.fmt.pix.height * 3) / 4) {
+		unicam_schedule_next_buffer(node);
+		node->late_scheduled++;
+	}
 	spin_unlock_irqrestore(&node->dma_queue_lock, flags);
 }
 
@@ -1641,6 +1675,14 @@ static int unicam_start_streaming(struct vb2_queue *vq, unsigned int count)
 	}
 
 	dev->sequence = 0;
+	for (i = 0; i < ARRAY_SIZE(dev->node); i++) {
+		dev->node[i].frames = 0;
+		dev->node[i].dropped_frames = 0;
+		dev->node[i].late_scheduled = 0;
+		dev->node[i].total_latency_ns = 0;
+		dev->node[i].max_latency_ns = 0;
+	}
+
 	ret = unicam_runtime_get(dev);
 	if (ret < 0) {
 		unicam_dbg(3, dev, "unicam_runtime_get failed\n");
@@ -2123,6 +2165,16 @@ static int unicam_log_status(struct file *file, void *fh)
 		    reg_read(dev, UNICAM_IVSTA));
 	unicam_info(dev, "Write pointer:       %08x\n",
 		    reg_read(dev, UNICAM_IBWP));
+	unicam_info(dev, "----Statistics----\n");
+	unicam_info(dev, "Frames captured:     %u\n", node->frames);
+	unicam_info(dev, "Frames dropped:      %u\n", node->dropped_frames);
+	unicam_info(dev, "Late scheduled bufs: %u\n", node->late_scheduled);
+	unicam_info(dev, "Avg/max latency:     %llu / %llu us\n",
+		    node->frames ?
+			div_u64(div_u64(node->total_latency_ns, node->frames),
+				1000) :
+			0,
+		    div_u64(node->max_latency_ns, 1000));
 
 	return 0;
 }
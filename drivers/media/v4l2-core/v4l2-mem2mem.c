@@ -462,11 +462,20 @@ static void v4l2_m2m_schedule_next_job(struct v4l2_m2m_dev *m2m_dev,
 	 */
 	__v4l2_m2m_try_queue(m2m_dev, m2m_ctx);
 
+	/*
+	 * Nothing to run: a job queued after curr_ctx was cleared is run by
+	 * whoever queued it, so there is no need to wake the worker.
+	 */
+	if (list_empty(&m2m_dev->job_queue))
+		return;
+
 	/*
 	 * We might be running in atomic context,
-	 * but the job must be run in non-atomic context.
+	 * but the job must be run in non-atomic context. Use the high
+	 * priority workqueue so the device does not sit idle behind
+	 * unrelated work between back-to-back jobs.
 	 */
-	schedule_work(&m2m_dev->job_work);
+	queue_work(system_highpri_wq, &m2m_dev->job_work);
 }
 
 /*
@@ -32,6 +32,7 @@
 #define SDDATA_FIFO_PIO_BURST   8
 #define CMD_DALLY_US            1
 
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/module.h>
 #include <linux/io.h>
@@ -53,6 +54,8 @@
 #include <linux/workqueue.h>
 #include <linux/interrupt.h>
 #include <linux/highmem.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
 #include <soc/bcm2835/raspberrypi-firmware.h>
 
 /* For mmc_card_blockaddr */
@@ -143,6 +146,25 @@
 
 #define MHZ 1000000
 
+/* mmc_data.host_cookie value for data mapped by bcm2835_sdhost_pre_req */
+#define COOKIE_PRE_MAPPED	1
+
+/* Transfer sizes are binned by power-of-two block count: 1, 2-3, ..., 128+ */
+#define XFER_SIZE_CLASSES	8
+
+/* Samples of each mode gathered before pio_limit is reconsidered */
+#define PIO_ADAPT_SAMPLES	32
+#define PIO_ADAPT_LIMIT_MAX	64
+/* One in this many reads just below pio_limit is sent by DMA as a probe */
+#define PIO_ADAPT_PROBE_INTERVAL	8
+
+struct bcm2835_sdhost_xfer_stats {
+	u64 count;
+	u64 blocks;
+	u64 total_ns;
+	u64 max_ns;
+	u64 cpu_ns;
+};
 
 struct bcm2835_host {
 	spinlock_t		lock;
@@ -216,6 +238,25 @@ struct bcm2835_host {
 	u32				overclock_50;	/* frequency to use when 50MHz is requested (in MHz) */
 	u32				overclock;	/* Current frequency if overclocked, else zero */
 	u32				pio_limit;	/* Maximum block count for PIO (0 = always DMA) */
+	bool				pio_adaptive;	/* Tune pio_limit from measured read costs */
+
+	ktime_t				data_start;	/* When the current data request was issued */
+	bool				data_dma;	/* Current data request uses DMA */
+	u64				data_cpu_ns;	/* CPU time spent moving its data */
+
+	/* Indexed by [write][dma][size class], protected by lock */
+	struct bcm2835_sdhost_xfer_stats xfer_stats[2][2][XFER_SIZE_CLASSES];
+
+	/* Reads just below pio_limit since it was last adjusted */
+	struct {
+		u32 window_reads;
+		u32 pio_count;
+		u32 dma_count;
+		u64 pio_blocks;
+		u64 dma_blocks;
+		u64 pio_ns;
+		u64 dma_ns;
+	} pio_adapt;
 
 	u32				sectors;	/* Cached card size in sectors */
 };
@@ -524,6 +565,7 @@ static void bcm2835_sdhost_dma_complete(void *param)
 	struct bcm2835_host *host = param;
 	struct mmc_data *data = host->data;
 	unsigned long flags;
+	u64 start = ktime_get_ns();
 
 	spin_lock_irqsave(&host->lock, flags);
 	log_event("DMA<", host->data, bcm2835_sdhost_read(host, SDHSTS));
@@ -531,9 +573,19 @@ static void bcm2835_sdhost_dma_complete(void *param)
 		  bcm2835_sdhost_read(host, SDEDM));
 
 	if (host->dma_chan) {
-		dma_unmap_sg(host->dma_chan->device->dev,
-			     data->sg, data->sg_len,
-			     host->dma_dir);
+		/*
+		 * The drain below writes just past the end of the mapped
+		 * buffer, possibly into a cache line the two share, so a
+		 * pre-mapped buffer has to be unmapped now: the invalidate
+		 * done by the unmap in post_req would discard those words.
+		 */
+		if (data->host_cookie != COOKIE_PRE_MAPPED ||
+		    host->drain_words) {
+			dma_unmap_sg(host->dma_chan->device->dev,
+				     data->sg, data->sg_len,
+				     host->dma_dir);
+			data->host_cookie = 0;
+		}
 
 		host->dma_chan = NULL;
 	}
@@ -561,6 +613,7 @@ static void bcm2835_sdhost_dma_complete(void *param)
 		kunmap_atomic(page);
 	}
 
+	host->data_cpu_ns += ktime_get_ns() - start;
 	bcm2835_sdhost_finish_data(host);
 
 	log_event("DMA>", host->data, 0);
@@ -751,6 +804,7 @@ static void bcm2835_sdhost_transfer_pio(struct bcm2835_host *host)
 {
 	u32 sdhsts;
 	bool is_read;
+	u64 start = ktime_get_ns();
 	BUG_ON(!host->data);
 	log_event("XFP<", host->data, host->blocks);
 
@@ -777,15 +831,106 @@ static void bcm2835_sdhost_transfer_pio(struct bcm2835_host *host)
 		       sdhsts);
 		host->data->error = -ETIMEDOUT;
 	}
+	host->data_cpu_ns += ktime_get_ns() - start;
 	log_event("XFP>", host->data, host->blocks);
 }
 
+/* The block doesn't manage the FIFO DREQs properly for multi-block
+   transfers, so don't attempt to DMA the final few words.
+   Unfortunately this requires the final sg entry to be trimmed.
+   N.B. This code demands that the overspill is contained in
+   a single sg entry.
+*/
+static u32 bcm2835_sdhost_drain_len(struct mmc_data *data)
+{
+	if ((data->blocks > 1) && (data->flags & MMC_DATA_READ))
+		return min((u32)(FIFO_READ_THRESHOLD - 1) * 4,
+			   (u32)data->blocks * data->blksz);
+
+	return 0;
+}
+
+static void bcm2835_sdhost_trim_sg(struct mmc_data *data, u32 len)
+{
+	struct scatterlist *sg = sg_last(data->sg, data->sg_len);
+
+	BUG_ON(sg->length < len);
+	sg->length -= len;
+}
+
+/*
+ * Reads above pio_limit use DMA. While pio_adaptive is set, every
+ * PIO_ADAPT_PROBE_INTERVAL-th read just below it does too, so that
+ * bcm2835_sdhost_adapt_pio_limit() can cost both modes on the same sizes.
+ */
+static bool bcm2835_sdhost_use_dma(struct bcm2835_host *host,
+				   struct mmc_data *data)
+{
+	u32 limit = host->pio_limit;
+
+	if (!host->use_dma)
+		return false;
+	if (data->blocks > limit)
+		return true;
+	if (!host->pio_adaptive || !(data->flags & MMC_DATA_READ) ||
+	    data->blocks <= limit / 2)
+		return false;
+
+	return !(++host->pio_adapt.window_reads % PIO_ADAPT_PROBE_INTERVAL);
+}
+
+static void bcm2835_sdhost_pre_req(struct mmc_host *mmc,
+				   struct mmc_request *mrq)
+{
+	struct bcm2835_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	u32 drain_len;
+
+	if (!data)
+		return;
+
+	data->host_cookie = 0;
+	if (!host->use_dma || data->blocks <= host->pio_limit)
+		return;
+
+	/* Map the next request's buffers while the current one runs. */
+	drain_len = bcm2835_sdhost_drain_len(data);
+	bcm2835_sdhost_trim_sg(data, drain_len);
+
+	data->sg_count = dma_map_sg(host->dma_chan_rxtx->device->dev,
+				    data->sg, data->sg_len,
+				    (data->flags & MMC_DATA_READ) ?
+				    DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	if (data->sg_count)
+		data->host_cookie = COOKIE_PRE_MAPPED;
+	else
+		sg_last(data->sg, data->sg_len)->length += drain_len;
+}
+
+static void bcm2835_sdhost_post_req(struct mmc_host *mmc,
+				    struct mmc_request *mrq, int err)
+{
+	struct bcm2835_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data || data->host_cookie != COOKIE_PRE_MAPPED)
+		return;
+
+	dma_unmap_sg(host->dma_chan_rxtx->device->dev,
+		     data->sg, data->sg_len,
+		     (data->flags & MMC_DATA_READ) ?
+		     DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	data->host_cookie = 0;
+}
+
 static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 	struct mmc_data *data)
 {
 	int len, dir_data, dir_slave;
 	struct dma_async_tx_descriptor *desc = NULL;
 	struct dma_chan *dma_chan;
+	u32 drain_len;
+	u64 start = ktime_get_ns();
 
 	log_event("PRD<", data, 0);
 	pr_debug("bcm2835_sdhost_prepare_dma()\n");
@@ -804,31 +949,17 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 	BUG_ON(!dma_chan->device->dev);
 	BUG_ON(!data->sg);
 
-	/* The block doesn't manage the FIFO DREQs properly for multi-block
-	   transfers, so don't attempt to DMA the final few words.
-	   Unfortunately this requires the final sg entry to be trimmed.
-	   N.B. This code demands that the overspill is contained in
-	   a single sg entry.
-	*/
+	/* Data mapped by pre_req has had its final sg entry trimmed already */
+	drain_len = bcm2835_sdhost_drain_len(data);
+	if (data->host_cookie != COOKIE_PRE_MAPPED)
+		bcm2835_sdhost_trim_sg(data, drain_len);
 
-	host->drain_words = 0;
-	if ((data->blocks > 1) && (dir_data == DMA_FROM_DEVICE)) {
-		struct scatterlist *sg;
-		u32 len;
-		int i;
-
-		len = min((u32)(FIFO_READ_THRESHOLD - 1) * 4,
-			  (u32)data->blocks * data->blksz);
-
-		for_each_sg(data->sg, sg, data->sg_len, i) {
-			if (sg_is_last(sg)) {
-				BUG_ON(sg->length < len);
-				sg->length -= len;
-				host->drain_page = sg_page(sg);
-				host->drain_offset = sg->offset + sg->length;
-			}
-		}
-		host->drain_words = len/4;
+	host->drain_words = drain_len / 4;
+	if (drain_len) {
+		struct scatterlist *sg = sg_last(data->sg, data->sg_len);
+
+		host->drain_page = sg_page(sg);
+		host->drain_offset = sg->offset + sg->length;
 	}
 
 	/* The parameters have already been validated, so this will not fail */
@@ -837,8 +968,11 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 				     &host->dma_cfg_rx :
 				     &host->dma_cfg_tx);
 
-	len = dma_map_sg(dma_chan->device->dev, data->sg, data->sg_len,
-			 dir_data);
+	if (data->host_cookie == COOKIE_PRE_MAPPED)
+		len = data->sg_count;
+	else
+		len = dma_map_sg(dma_chan->device->dev, data->sg,
+				 data->sg_len, dir_data);
 
 	log_event("PRD2", len, 0);
 	if (len > 0)
@@ -854,6 +988,7 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 		host->dma_chan = dma_chan;
 		host->dma_dir = dir_data;
 	}
+	host->data_cpu_ns += ktime_get_ns() - start;
 	log_event("PDM>", data, 0);
 }
 
@@ -1204,9 +1339,12 @@ static void bcm2835_sdhost_finish_command(struct bcm2835_host *host,
 		unsigned long wait_max;
 
 		if (!irq_flags) {
-			/* Schedule the work */
+			/*
+			 * Schedule the work - the request is stalled until
+			 * it runs, so keep it off the normal system_wq pool
+			 */
 			log_event("CWWQ", 0, 0);
-			schedule_work(&host->cmd_wait_wq);
+			queue_work(system_highpri_wq, &host->cmd_wait_wq);
 			return;
 		}
 
@@ -1680,8 +1818,9 @@ static void bcm2835_sdhost_request(struct mmc_host *mmc, struct mmc_request *mrq
 		return;
 	}
 
-	if (host->use_dma && mrq->data &&
-	    (mrq->data->blocks > host->pio_limit))
+	host->data_cpu_ns = 0;
+	if (mrq->data && (mrq->data->host_cookie == COOKIE_PRE_MAPPED ||
+			  bcm2835_sdhost_use_dma(host, mrq->data)))
 		bcm2835_sdhost_prepare_dma(host, mrq->data);
 
 	if (host->reset_clock)
@@ -1691,6 +1830,8 @@ static void bcm2835_sdhost_request(struct mmc_host *mmc, struct mmc_request *mrq
 
 	WARN_ON(host->mrq != NULL);
 	host->mrq = mrq;
+	host->data_start = ktime_get();
+	host->data_dma = !!host->dma_desc;
 
 	edm = bcm2835_sdhost_read(host, SDEDM);
 	fsm = edm & SDEDM_FSM_MASK;
@@ -1773,6 +1914,8 @@ static void bcm2835_sdhost_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 
 static struct mmc_host_ops bcm2835_sdhost_ops = {
 	.request = bcm2835_sdhost_request,
+	.pre_req = bcm2835_sdhost_pre_req,
+	.post_req = bcm2835_sdhost_post_req,
 	.set_ios = bcm2835_sdhost_set_ios,
 	.hw_reset = bcm2835_sdhost_reset,
 };
@@ -1804,6 +1947,76 @@ static void bcm2835_sdhost_cmd_wait_work(struct work_struct *work)
 	spin_unlock_irqrestore(&host->lock, flags);
 }
 
+static void bcm2835_sdhost_adapt_pio_limit(struct bcm2835_host *host,
+					   struct mmc_data *data)
+{
+	u32 limit = host->pio_limit;
+	u64 pio_cost, dma_cost;
+
+	/* Only reads in the window just below the limit are compared */
+	if (!host->pio_adaptive || !limit || !(data->flags & MMC_DATA_READ) ||
+	    data->blocks <= limit / 2 || data->blocks > limit)
+		return;
+
+	if (host->data_dma) {
+		host->pio_adapt.dma_count++;
+		host->pio_adapt.dma_blocks += data->blocks;
+		host->pio_adapt.dma_ns += host->data_cpu_ns;
+	} else {
+		host->pio_adapt.pio_count++;
+		host->pio_adapt.pio_blocks += data->blocks;
+		host->pio_adapt.pio_ns += host->data_cpu_ns;
+	}
+
+	if (host->pio_adapt.pio_count < PIO_ADAPT_SAMPLES ||
+	    host->pio_adapt.dma_count < PIO_ADAPT_SAMPLES)
+		return;
+
+	/* Compare the CPU cost per block of both modes on the same sizes */
+	pio_cost = div64_u64(host->pio_adapt.pio_ns, host->pio_adapt.pio_blocks);
+	dma_cost = div64_u64(host->pio_adapt.dma_ns, host->pio_adapt.dma_blocks);
+
+	/*
+	 * The CPU cost of DMA is mostly per request, so per block it about
+	 * halves at twice the size while that of PIO stays the same. Only
+	 * raise the limit if PIO would still be cheaper there.
+	 */
+	if (dma_cost < pio_cost && limit > 1)
+		limit /= 2;
+	else if (2 * pio_cost < dma_cost && limit < PIO_ADAPT_LIMIT_MAX)
+		limit *= 2;
+
+	if (limit != host->pio_limit) {
+		if (host->debug)
+			pr_info("%s: pio_limit %u -> %u (%llu vs %llu CPU ns/block)\n",
+				mmc_hostname(host->mmc), host->pio_limit,
+				limit, pio_cost, dma_cost);
+		host->pio_limit = limit;
+	}
+
+	memset(&host->pio_adapt, 0, sizeof(host->pio_adapt));
+}
+
+static void bcm2835_sdhost_record_xfer(struct bcm2835_host *host,
+				       struct mmc_data *data)
+{
+	struct bcm2835_sdhost_xfer_stats *stats;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), host->data_start));
+
+	stats = &host->xfer_stats[!!(data->flags & MMC_DATA_WRITE)]
+				 [host->data_dma]
+				 [min_t(u32, ilog2(data->blocks),
+					XFER_SIZE_CLASSES - 1)];
+	stats->count++;
+	stats->blocks += data->blocks;
+	stats->total_ns += ns;
+	if (ns > stats->max_ns)
+		stats->max_ns = ns;
+	stats->cpu_ns += host->data_cpu_ns;
+
+	bcm2835_sdhost_adapt_pio_limit(host, data);
+}
+
 static void bcm2835_sdhost_tasklet_finish(unsigned long param)
 {
 	struct bcm2835_host *host;
@@ -1829,6 +2042,9 @@ static void bcm2835_sdhost_tasklet_finish(unsigned long param)
 
 	mrq = host->mrq;
 
+	if (mrq->data && mrq->data->blocks && !mrq->data->error)
+		bcm2835_sdhost_record_xfer(host, mrq->data);
+
 	/* Drop the overclock after any data corruption, or after any
 	 * error while overclocked. Ignore errors for status commands,
 	 * as they are likely when a card is ejected. */
@@ -1884,6 +2100,64 @@ static void bcm2835_sdhost_tasklet_finish(unsigned long param)
 	log_event("TSK>", mrq, 0);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int bcm2835_sdhost_xfer_stats_show(struct seq_file *s, void *data)
+{
+	struct bcm2835_host *host = s->private;
+	unsigned long flags;
+	int dir, dma, class;
+
+	spin_lock_irqsave(&host->lock, flags);
+
+	seq_printf(s, "pio_limit: %u%s\n", host->pio_limit,
+		   host->pio_adaptive ? " (adaptive)" : "");
+	seq_puts(s, "dir   mode size      count       blocks  avg_us  max_us  cpu_us\n");
+	for (dir = 0; dir < 2; dir++) {
+		for (dma = 0; dma < 2; dma++) {
+			for (class = 0; class < XFER_SIZE_CLASSES; class++) {
+				struct bcm2835_sdhost_xfer_stats *stats =
+					&host->xfer_stats[dir][dma][class];
+
+				if (!stats->count)
+					continue;
+
+				seq_printf(s, "%-5s %-4s %4u%-5s %8llu %12llu %7llu %7llu %7llu\n",
+					   dir ? "write" : "read",
+					   dma ? "dma" : "pio",
+					   1 << class,
+					   class == XFER_SIZE_CLASSES - 1 ?
+					   "+" : "",
+					   stats->count, stats->blocks,
+					   div64_u64(stats->total_ns,
+						     stats->count * 1000),
+					   div_u64(stats->max_ns, 1000),
+					   div64_u64(stats->cpu_ns,
+						     stats->count * 1000));
+			}
+		}
+	}
+
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bcm2835_sdhost_xfer_stats);
+
+static void bcm2835_sdhost_debugfs_init(struct bcm2835_host *host)
+{
+	struct dentry *root = host->mmc->debugfs_root;
+
+	debugfs_create_file("xfer_stats", 0444, root, host,
+			    &bcm2835_sdhost_xfer_stats_fops);
+	debugfs_create_u32("pio_limit", 0644, root, &host->pio_limit);
+	debugfs_create_bool("pio_adaptive", 0644, root, &host->pio_adaptive);
+}
+#else
+static inline void bcm2835_sdhost_debugfs_init(struct bcm2835_host *host)
+{
+}
+#endif
+
 int bcm2835_sdhost_add_host(struct bcm2835_host *host)
 {
 	struct mmc_host *mmc;
@@ -1983,6 +2257,7 @@ int bcm2835_sdhost_add_host(struct bcm2835_host *host)
 	}
 
 	mmc_add_host(mmc);
+	bcm2835_sdhost_debugfs_init(host);
 
 	pio_limit_string[0] = '\0';
 	if (host->use_dma && (host->pio_limit > 0))
@@ -2023,6 +2298,7 @@ static int bcm2835_sdhost_probe(struct platform_device *pdev)
 	host->mmc = mmc;
 	host->pio_timeout = msecs_to_jiffies(500);
 	host->pio_limit = 1;
+	host->pio_adaptive = false;
 	host->max_delay = 1; /* Warn if over 1ms */
 	host->allow_dma = 1;
 	spin_lock_init(&host->lock);
@@ -2054,9 +2330,11 @@ static int bcm2835_sdhost_probe(struct platform_device *pdev)
 		of_property_read_u32(node,
 				     "brcm,overclock-50",
 				     &host->user_overclock_50);
-		of_property_read_u32(node,
-				     "brcm,pio-limit",
-				     &host->pio_limit);
+		/* An explicit limit is honoured as is */
+		if (!of_property_read_u32(node,
+					  "brcm,pio-limit",
+					  &host->pio_limit))
+			host->pio_adaptive = false;
 		host->allow_dma =
 			!of_property_read_bool(node, "brcm,force-pio");
 		host->debug = of_property_read_bool(node, "brcm,debug");
@@ -2185,6 +2463,7 @@ static struct platform_driver bcm2835_sdhost_driver = {
 	.driver     = {
 		.name		= DRIVER_NAME,
 		.owner		= THIS_MODULE,
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 		.of_match_table	= bcm2835_sdhost_match,
 	},
 };
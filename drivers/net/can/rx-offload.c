@@ -301,6 +301,18 @@ int can_rx_offload_queue_tail(struct can_rx_offload *offload,
 }
 EXPORT_SYMBOL_GPL(can_rx_offload_queue_tail);
 
+/* Called at the end of a threaded IRQ handler that queued frames. NAPI
+ * scheduled from process context only marks the softirq pending, so run
+ * it here rather than waiting for the next hard IRQ on this CPU.
+ */
+void can_rx_offload_threaded_irq_finish(struct can_rx_offload *offload)
+{
+	local_bh_disable();
+	can_rx_offload_schedule(offload);
+	local_bh_enable();
+}
+EXPORT_SYMBOL_GPL(can_rx_offload_threaded_irq_finish);
+
 static int can_rx_offload_init_queue(struct net_device *dev,
 				     struct can_rx_offload *offload,
 				     unsigned int weight)
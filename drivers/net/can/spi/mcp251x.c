@@ -23,6 +23,7 @@
 #include <linux/can/core.h>
 #include <linux/can/dev.h>
 #include <linux/can/led.h>
+#include <linux/can/rx-offload.h>
 #include <linux/clk.h>
 #include <linux/completion.h>
 #include <linux/delay.h>
@@ -203,6 +204,8 @@
 
 #define TX_ECHO_SKB_MAX	1
 
+#define MCP251X_NAPI_WEIGHT	32
+
 #define MCP251X_OST_DELAY_MS	(5)
 
 #define DEVICE_NAME "mcp251x"
@@ -227,15 +230,28 @@ enum mcp251x_model {
 
 struct mcp251x_priv {
 	struct can_priv	   can;
+	struct can_rx_offload offload;
 	struct net_device *net;
 	struct spi_device *spi;
 	enum mcp251x_model model;
 
+	/* Taken in the hard IRQ handler, stamps the first batch of frames */
+	ktime_t irq_ts;
+
 	struct mutex mcp_lock; /* SPI device lock */
 
 	u8 *spi_tx_buf;
 	u8 *spi_rx_buf;
 
+	/* Prebuilt full-duplex messages for the register and RX buffer
+	 * accesses done on every interrupt, validated once at probe.
+	 */
+	struct spi_transfer reg_xfer;
+	struct spi_message reg_msg;
+	struct spi_transfer rxb_xfer;
+	struct spi_message rxb_msg;
+	bool msgs_optimized;
+
 	struct sk_buff *tx_skb;
 	int tx_len;
 
@@ -302,18 +318,70 @@ static int mcp251x_spi_trans(struct spi_device *spi, int len)
 		.len = len,
 		.cs_change = 0,
 	};
-	struct spi_message m;
+	struct spi_message m, *msg = &m;
 	int ret;
 
-	spi_message_init(&m);
-	spi_message_add_tail(&t, &m);
+	if (priv->msgs_optimized && len == priv->reg_xfer.len) {
+		msg = &priv->reg_msg;
+	} else if (priv->msgs_optimized && len == priv->rxb_xfer.len) {
+		msg = &priv->rxb_msg;
+	} else {
+		spi_message_init(&m);
+		spi_message_add_tail(&t, &m);
+	}
 
-	ret = spi_sync(spi, &m);
+	ret = spi_sync(spi, msg);
 	if (ret)
 		dev_err(&spi->dev, "spi transfer failed: ret = %d\n", ret);
 	return ret;
 }
 
+/* The 4 byte register accesses (two register read, two register write
+ * and bit modify) and the full RX buffer read happen on every interrupt,
+ * so give them messages that are validated once rather than per call.
+ * The buffers are shared with mcp251x_spi_trans(), only their contents
+ * change between submissions.
+ */
+static void mcp251x_spi_optimize_msgs(struct spi_device *spi)
+{
+	struct mcp251x_priv *priv = spi_get_drvdata(spi);
+
+	if (spi->controller->flags & SPI_CONTROLLER_HALF_DUPLEX)
+		return;
+
+	priv->reg_xfer.tx_buf = priv->spi_tx_buf;
+	priv->reg_xfer.rx_buf = priv->spi_rx_buf;
+	priv->reg_xfer.len = 4;
+	spi_message_init_with_transfers(&priv->reg_msg, &priv->reg_xfer, 1);
+
+	priv->rxb_xfer.tx_buf = priv->spi_tx_buf;
+	priv->rxb_xfer.rx_buf = priv->spi_rx_buf;
+	priv->rxb_xfer.len = SPI_TRANSFER_BUF_LEN;
+	spi_message_init_with_transfers(&priv->rxb_msg, &priv->rxb_xfer, 1);
+
+	/* Plain spi_sync() of a fresh message still works if this fails */
+	if (spi_optimize_message(spi, &priv->reg_msg))
+		return;
+	if (spi_optimize_message(spi, &priv->rxb_msg)) {
+		spi_unoptimize_message(&priv->reg_msg);
+		return;
+	}
+
+	priv->msgs_optimized = true;
+}
+
+static void mcp251x_spi_unoptimize_msgs(struct spi_device *spi)
+{
+	struct mcp251x_priv *priv = spi_get_drvdata(spi);
+
+	if (!priv->msgs_optimized)
+		return;
+
+	spi_unoptimize_message(&priv->rxb_msg);
+	spi_unoptimize_message(&priv->reg_msg);
+	priv->msgs_optimized = false;
+}
+
 static u8 mcp251x_read_reg(struct spi_device *spi, u8 reg)
 {
 	struct mcp251x_priv *priv = spi_get_drvdata(spi);
@@ -682,7 +750,7 @@ static void mcp251x_hw_rx_frame(struct spi_device *spi, u8 *buf,
 	}
 }
 
-static void mcp251x_hw_rx(struct spi_device *spi, int buf_idx)
+static void mcp251x_hw_rx(struct spi_device *spi, int buf_idx, ktime_t ts)
 {
 	struct mcp251x_priv *priv = spi_get_drvdata(spi);
 	struct sk_buff *skb;
@@ -723,12 +791,15 @@ static void mcp251x_hw_rx(struct spi_device *spi, int buf_idx)
 	frame->can_dlc = get_can_dlc(buf[RXBDLC_OFF] & RXBDLC_LEN_MASK);
 	memcpy(frame->data, buf + RXBDAT_OFF, frame->can_dlc);
 
-	priv->net->stats.rx_packets++;
-	priv->net->stats.rx_bytes += frame->can_dlc;
+	skb->tstamp = ts;
 
 	can_led_event(priv->net, CAN_LED_EVENT_RX);
 
-	netif_rx_ni(skb);
+	/* Frames come out of the chip in order, so no sorting is needed.
+	 * rx_packets and rx_bytes are accounted by the NAPI poll.
+	 */
+	if (can_rx_offload_queue_tail(&priv->offload, skb))
+		priv->net->stats.rx_fifo_errors++;
 }
 
 static void mcp251x_hw_sleep(struct spi_device *spi)
@@ -944,6 +1015,7 @@ static int mcp251x_stop(struct net_device *net)
 
 	priv->force_quit = 1;
 	free_irq(spi->irq, priv);
+	can_rx_offload_disable(&priv->offload);
 	destroy_workqueue(priv->wq);
 	priv->wq = NULL;
 
@@ -1049,11 +1121,21 @@ static void mcp251x_restart_work_handler(struct work_struct *ws)
 	mutex_unlock(&priv->mcp_lock);
 }
 
+static irqreturn_t mcp251x_can_irq(int irq, void *dev_id)
+{
+	struct mcp251x_priv *priv = dev_id;
+
+	priv->irq_ts = ktime_get_real();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 {
 	struct mcp251x_priv *priv = dev_id;
 	struct spi_device *spi = priv->spi;
 	struct net_device *net = priv->net;
+	ktime_t ts = priv->irq_ts;
 
 	mutex_lock(&priv->mcp_lock);
 	while (!priv->force_quit) {
@@ -1069,7 +1151,7 @@ static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 
 		/* receive buffer 0 */
 		if (intf & CANINTF_RX0IF) {
-			mcp251x_hw_rx(spi, 0);
+			mcp251x_hw_rx(spi, 0, ts);
 			/* Free one buffer ASAP
 			 * (The MCP2515/25625 does this automatically.)
 			 */
@@ -1080,7 +1162,7 @@ static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 
 		/* receive buffer 1 */
 		if (intf & CANINTF_RX1IF) {
-			mcp251x_hw_rx(spi, 1);
+			mcp251x_hw_rx(spi, 1, ts);
 			/* The MCP2515/25625 does this automatically. */
 			if (mcp251x_is_2510(spi))
 				clear_intf |= CANINTF_RX1IF;
@@ -1176,8 +1258,14 @@ static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 			}
 			netif_wake_queue(net);
 		}
+
+		/* Frames picked up on later passes arrived after the IRQ */
+		ts = ktime_get_real();
 	}
 	mutex_unlock(&priv->mcp_lock);
+
+	can_rx_offload_threaded_irq_finish(&priv->offload);
+
 	return IRQ_HANDLED;
 }
 
@@ -1204,12 +1292,14 @@ static int mcp251x_open(struct net_device *net)
 	if (!dev_fwnode(&spi->dev))
 		flags = IRQF_TRIGGER_FALLING;
 
-	ret = request_threaded_irq(spi->irq, NULL, mcp251x_can_ist,
+	can_rx_offload_enable(&priv->offload);
+
+	ret = request_threaded_irq(spi->irq, mcp251x_can_irq, mcp251x_can_ist,
 				   flags | IRQF_ONESHOT, dev_name(&spi->dev),
 				   priv);
 	if (ret) {
 		dev_err(&spi->dev, "failed to acquire irq %d\n", spi->irq);
-		goto out_close;
+		goto out_rx_offload_disable;
 	}
 
 	priv->wq = alloc_workqueue("mcp251x_wq", WQ_FREEZABLE | WQ_MEM_RECLAIM,
@@ -1243,6 +1333,8 @@ static int mcp251x_open(struct net_device *net)
 out_clean:
 	free_irq(spi->irq, priv);
 	mcp251x_hw_sleep(spi);
+out_rx_offload_disable:
+	can_rx_offload_disable(&priv->offload);
 out_close:
 	mcp251x_power_enable(priv->transceiver, 0);
 	close_candev(net);
@@ -1317,14 +1409,19 @@ static int mcp251x_can_probe(struct spi_device *spi)
 	if (!net)
 		return -ENOMEM;
 
-	ret = clk_prepare_enable(clk);
+	priv = netdev_priv(net);
+	ret = can_rx_offload_add_manual(net, &priv->offload,
+					MCP251X_NAPI_WEIGHT);
 	if (ret)
 		goto out_free;
 
+	ret = clk_prepare_enable(clk);
+	if (ret)
+		goto out_rx_offload_del;
+
 	net->netdev_ops = &mcp251x_netdev_ops;
 	net->flags |= IFF_ECHO;
 
-	priv = netdev_priv(net);
 	priv->can.bittiming_const = &mcp251x_bittiming_const;
 	priv->can.do_set_mode = mcp251x_do_set_mode;
 	priv->can.clock.freq = freq / 2;
@@ -1378,6 +1475,8 @@ static int mcp251x_can_probe(struct spi_device *spi)
 		goto error_probe;
 	}
 
+	mcp251x_spi_optimize_msgs(spi);
+
 	SET_NETDEV_DEV(net, &spi->dev);
 
 	/* Here is OK to not lock the MCP, no one knows about it yet */
@@ -1405,11 +1504,15 @@ static int mcp251x_can_probe(struct spi_device *spi)
 	return 0;
 
 error_probe:
+	mcp251x_spi_unoptimize_msgs(spi);
 	mcp251x_power_enable(priv->power, 0);
 
 out_clk:
 	clk_disable_unprepare(clk);
 
+out_rx_offload_del:
+	can_rx_offload_del(&priv->offload);
+
 out_free:
 	free_candev(net);
 
@@ -1424,10 +1527,14 @@ static int mcp251x_can_remove(struct spi_device *spi)
 
 	unregister_candev(net);
 
+	mcp251x_spi_unoptimize_msgs(spi);
+
 	mcp251x_power_enable(priv->power, 0);
 
 	clk_disable_unprepare(priv->clk);
 
+	can_rx_offload_del(&priv->offload);
+
 	free_candev(net);
 
 	return 0;
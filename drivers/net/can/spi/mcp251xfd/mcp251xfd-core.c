@@ -324,6 +324,35 @@ mcp251xfd_tx_ring_init_tx_obj(const struct mcp251xfd_priv *priv,
 					ARRAY_SIZE(tx_obj->xfer));
 }
 
+/* Prepare an array of identical transfers, each setting the UINC bit
+ * once, so that a FIFO tail can be advanced by several objects with a
+ * single SPI message.
+ */
+static void
+mcp251xfd_ring_init_uinc_xfer(struct spi_transfer *xfers, const int num,
+			      const union mcp251xfd_write_reg_buf *uinc_buf,
+			      const u8 len)
+{
+	struct spi_transfer *xfer;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		xfer = &xfers[i];
+		xfer->tx_buf = uinc_buf;
+		xfer->len = len;
+		xfer->cs_change = 1;
+		xfer->cs_change_delay.value = 0;
+		xfer->cs_change_delay.unit = SPI_DELAY_UNIT_NSECS;
+	}
+
+	/* "cs_change == 1" on the last transfer would leave the chip
+	 * select active after the message, which makes the chip treat
+	 * the next register access as data. The users therefore always
+	 * send the tail end of the array.
+	 */
+	xfer->cs_change = 0;
+}
+
 static void mcp251xfd_ring_init(struct mcp251xfd_priv *priv)
 {
 	struct mcp251xfd_tx_ring *tx_ring;
@@ -338,6 +367,15 @@ static void mcp251xfd_ring_init(struct mcp251xfd_priv *priv)
 	priv->tef.head = 0;
 	priv->tef.tail = 0;
 
+	/* FIFO increment TEF tail pointer */
+	addr = MCP251XFD_REG_TEFCON;
+	val = MCP251XFD_REG_TEFCON_UINC;
+	len = mcp251xfd_cmd_prepare_write_reg(priv, &priv->tef.uinc_buf,
+					      addr, val, val);
+	mcp251xfd_ring_init_uinc_xfer(priv->tef.uinc_xfer,
+				      ARRAY_SIZE(priv->tef.uinc_xfer),
+				      &priv->tef.uinc_buf, len);
+
 	/* TX */
 	tx_ring = priv->tx;
 	tx_ring->head = 0;
@@ -360,6 +398,15 @@ static void mcp251xfd_ring_init(struct mcp251xfd_priv *priv)
 		rx_ring->nr = i;
 		rx_ring->fifo_nr = MCP251XFD_RX_FIFO(i);
 
+		/* FIFO increment RX tail pointer */
+		addr = MCP251XFD_REG_FIFOCON(rx_ring->fifo_nr);
+		val = MCP251XFD_REG_FIFOCON_UINC;
+		len = mcp251xfd_cmd_prepare_write_reg(priv, &rx_ring->uinc_buf,
+						      addr, val, val);
+		mcp251xfd_ring_init_uinc_xfer(rx_ring->uinc_xfer,
+					      ARRAY_SIZE(rx_ring->uinc_xfer),
+					      &rx_ring->uinc_buf, len);
+
 		if (!prev_rx_ring)
 			rx_ring->base =
 				mcp251xfd_get_tx_obj_addr(tx_ring,
@@ -416,7 +463,8 @@ static int mcp251xfd_ring_alloc(struct mcp251xfd_priv *priv)
 		int rx_obj_num;
 
 		rx_obj_num = ram_free / rx_obj_size;
-		rx_obj_num = min(1 << (fls(rx_obj_num) - 1), 32);
+		rx_obj_num = min(1 << (fls(rx_obj_num) - 1),
+				 MCP251XFD_RX_OBJ_NUM_MAX);
 
 		rx_ring = kzalloc(sizeof(*rx_ring) + rx_obj_size * rx_obj_num,
 				  GFP_KERNEL);
@@ -1214,10 +1262,8 @@ static int
 mcp251xfd_handle_tefif_one(struct mcp251xfd_priv *priv,
 			   const struct mcp251xfd_hw_tef_obj *hw_tef_obj)
 {
-	struct mcp251xfd_tx_ring *tx_ring = priv->tx;
 	struct net_device_stats *stats = &priv->ndev->stats;
 	u32 seq, seq_masked, tef_tail_masked;
-	int err;
 
 	seq = FIELD_GET(MCP251XFD_OBJ_FLAGS_SEQ_MCP2518FD_MASK,
 			hw_tef_obj->flags);
@@ -1238,18 +1284,9 @@ mcp251xfd_handle_tefif_one(struct mcp251xfd_priv *priv,
 					    mcp251xfd_get_tef_tail(priv),
 					    hw_tef_obj->ts);
 	stats->tx_packets++;
-
-	/* finally increment the TEF pointer */
-	err = regmap_update_bits(priv->map_reg, MCP251XFD_REG_TEFCON,
-				 GENMASK(15, 8),
-				 MCP251XFD_REG_TEFCON_UINC);
-	if (err)
-		return err;
-
 	priv->tef.tail++;
-	tx_ring->tail++;
 
-	return mcp251xfd_check_tef_tail(priv);
+	return 0;
 }
 
 static int mcp251xfd_tef_ring_update(struct mcp251xfd_priv *priv)
@@ -1336,6 +1373,28 @@ static int mcp251xfd_handle_tefif(struct mcp251xfd_priv *priv)
 	}
 
  out_netif_wake_queue:
+	len = i;	/* number of handled good TEFs */
+	if (len) {
+		struct mcp251xfd_tef_ring *ring = &priv->tef;
+		int offset;
+
+		/* Increment the TEF FIFO tail pointer 'len' times in a
+		 * single SPI message, ending on the last transfer of
+		 * the array, which deasserts the chip select.
+		 */
+		offset = ARRAY_SIZE(ring->uinc_xfer) - len;
+		err = spi_sync_transfer(priv->spi,
+					ring->uinc_xfer + offset, len);
+		if (err)
+			return err;
+
+		priv->tx->tail += len;
+
+		err = mcp251xfd_check_tef_tail(priv);
+		if (err)
+			return err;
+	}
+
 	mcp251xfd_ecc_tefif_successful(priv);
 
 	if (mcp251xfd_get_tx_free(priv->tx)) {
@@ -1442,13 +1501,7 @@ mcp251xfd_handle_rxif_one(struct mcp251xfd_priv *priv,
 	if (err)
 		stats->rx_fifo_errors++;
 
-	ring->tail++;
-
-	/* finally increment the RX pointer */
-	return regmap_update_bits(priv->map_reg,
-				  MCP251XFD_REG_FIFOCON(ring->fifo_nr),
-				  GENMASK(15, 8),
-				  MCP251XFD_REG_FIFOCON_UINC);
+	return 0;
 }
 
 static inline int
@@ -1480,6 +1533,8 @@ mcp251xfd_handle_rxif_ring(struct mcp251xfd_priv *priv,
 		return err;
 
 	while ((len = mcp251xfd_get_rx_linear_len(ring))) {
+		int offset;
+
 		rx_tail = mcp251xfd_get_rx_tail(ring);
 
 		err = mcp251xfd_rx_obj_read(priv, ring, hw_rx_obj,
@@ -1494,6 +1549,18 @@ mcp251xfd_handle_rxif_ring(struct mcp251xfd_priv *priv,
 			if (err)
 				return err;
 		}
+
+		/* Increment the RX FIFO tail pointer 'len' times in a
+		 * single SPI message, ending on the last transfer of
+		 * the array, which deasserts the chip select.
+		 */
+		offset = ARRAY_SIZE(ring->uinc_xfer) - len;
+		err = spi_sync_transfer(priv->spi,
+					ring->uinc_xfer + offset, len);
+		if (err)
+			return err;
+
+		ring->tail += len;
 	}
 
 	return 0;
@@ -36,6 +36,11 @@
 #include <linux/ipv6.h>
 #include <linux/phy.h>
 #include <linux/platform_data/bcmgenet.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
+#include <net/page_pool.h>
+#include <net/xdp_sock_drv.h>
 
 #include <asm/unaligned.h>
 
@@ -53,7 +58,18 @@
 	(TOTAL_DESC - priv->hw_params->tx_queues * priv->hw_params->tx_bds_per_q)
 
 #define RX_BUF_LENGTH		2048
-#define SKB_ALIGNMENT		32
+
+/* Rx buffers are whole page_pool pages with XDP headroom in front of the
+ * RSB and room for the skb_shared_info behind them, so that they can be
+ * handed to an XDP program and then wrapped in an skb with build_skb().
+ * Frames up to GENET_RX_COPYBREAK bytes are copied out instead, which lets
+ * their page go straight back to the pool.
+ */
+#define GENET_RX_HEADROOM	XDP_PACKET_HEADROOM
+#define GENET_RX_COPYBREAK	256
+/* A zero-copy UMEM frame must hold the RSB, alignment and a full frame */
+#define GENET_XSK_RX_MIN_LEN	(sizeof(struct status_64) + 2 + \
+				 ENET_MAX_MTU_SIZE)
 
 /* Tx/Rx DMA register offset, skip 256 descriptors */
 #define WORDS_PER_BD(p)		(p->hw_params->words_per_bd)
@@ -856,6 +872,19 @@ static int bcmgenet_get_coalesce(struct net_device *dev,
 	return 0;
 }
 
+static void bcmgenet_set_tx_coalesce(struct bcmgenet_tx_ring *ring, u32 pkts)
+{
+	bcmgenet_tdma_ring_writel(ring->priv, ring->index, pkts,
+				  DMA_MBUF_DONE_THRESH);
+}
+
+static void bcmgenet_set_ring_tx_coalesce(struct bcmgenet_tx_ring *ring,
+					  struct ethtool_coalesce *ec)
+{
+	ring->tx_max_coalesced_frames = ec->tx_max_coalesced_frames;
+	bcmgenet_set_tx_coalesce(ring, ring->tx_max_coalesced_frames);
+}
+
 static void bcmgenet_set_rx_coalesce(struct bcmgenet_rx_ring *ring,
 				     u32 usecs, u32 pkts)
 {
@@ -920,12 +949,8 @@ static int bcmgenet_set_coalesce(struct net_device *dev,
 	 * ethtool knob to do coalescing on a per-queue basis
 	 */
 	for (i = 0; i < priv->hw_params->tx_queues; i++)
-		bcmgenet_tdma_ring_writel(priv, i,
-					  ec->tx_max_coalesced_frames,
-					  DMA_MBUF_DONE_THRESH);
-	bcmgenet_tdma_ring_writel(priv, DESC_INDEX,
-				  ec->tx_max_coalesced_frames,
-				  DMA_MBUF_DONE_THRESH);
+		bcmgenet_set_ring_tx_coalesce(&priv->tx_rings[i], ec);
+	bcmgenet_set_ring_tx_coalesce(&priv->tx_rings[DESC_INDEX], ec);
 
 	for (i = 0; i < priv->hw_params->rx_queues; i++)
 		bcmgenet_set_ring_rx_coalesce(&priv->rx_rings[i], ec);
@@ -985,6 +1010,8 @@ struct bcmgenet_stats {
 			tx_rings[num].packets), \
 	STAT_GENET_SOFT_MIB("txq" __stringify(num) "_bytes", \
 			tx_rings[num].bytes), \
+	STAT_GENET_SOFT_MIB("txq" __stringify(num) "_doorbells_deferred", \
+			tx_rings[num].doorbells_deferred), \
 	STAT_GENET_SOFT_MIB("rxq" __stringify(num) "_bytes", \
 			rx_rings[num].bytes),	 \
 	STAT_GENET_SOFT_MIB("rxq" __stringify(num) "_packets", \
@@ -1789,6 +1816,15 @@ static struct sk_buff *bcmgenet_free_tx_cb(struct device *dev,
 		if (cb == GENET_CB(skb)->last_cb)
 			return skb;
 
+	} else if (cb->xdpf) {
+		/* XDP_TX frames stay mapped by their page_pool */
+		if (dma_unmap_addr(cb, dma_addr))
+			dma_unmap_single(dev, dma_unmap_addr(cb, dma_addr),
+					 dma_unmap_len(cb, dma_len),
+					 DMA_TO_DEVICE);
+		dma_unmap_addr_set(cb, dma_addr, 0);
+		xdp_return_frame(cb->xdpf);
+		cb->xdpf = NULL;
 	} else if (dma_unmap_addr(cb, dma_addr)) {
 		dma_unmap_page(dev,
 			       dma_unmap_addr(cb, dma_addr),
@@ -1800,22 +1836,24 @@ static struct sk_buff *bcmgenet_free_tx_cb(struct device *dev,
 	return NULL;
 }
 
-/* Simple helper to free a receive control block's resources */
-static struct sk_buff *bcmgenet_free_rx_cb(struct device *dev,
-					   struct enet_cb *cb)
+/* Simple helper to take the page off a receive control block
+ * Returns the page, synced for the CPU, which should be returned to the
+ * ring's page_pool by the caller if necessary.
+ */
+static struct page *bcmgenet_free_rx_cb(struct device *dev,
+					struct enet_cb *cb)
 {
-	struct sk_buff *skb;
+	struct page *page;
 
-	skb = cb->skb;
-	cb->skb = NULL;
+	page = cb->rx_page;
+	cb->rx_page = NULL;
 
-	if (dma_unmap_addr(cb, dma_addr)) {
-		dma_unmap_single(dev, dma_unmap_addr(cb, dma_addr),
-				 dma_unmap_len(cb, dma_len), DMA_FROM_DEVICE);
-		dma_unmap_addr_set(cb, dma_addr, 0);
-	}
+	if (page)
+		dma_sync_single_for_cpu(dev, dma_unmap_addr(cb, dma_addr),
+					dma_unmap_len(cb, dma_len),
+					DMA_BIDIRECTIONAL);
 
-	return skb;
+	return page;
 }
 
 /* Unlocked version of the reclaim routine */
@@ -1826,8 +1864,11 @@ static unsigned int __bcmgenet_tx_reclaim(struct net_device *dev,
 	unsigned int txbds_processed = 0;
 	unsigned int bytes_compl = 0;
 	unsigned int pkts_compl = 0;
+	unsigned int xdp_bytes = 0;
+	unsigned int xdp_pkts = 0;
 	unsigned int txbds_ready;
 	unsigned int c_index;
+	struct enet_cb *cb;
 	struct sk_buff *skb;
 
 	/* Clear status before servicing to reduce spurious interrupts */
@@ -1849,8 +1890,13 @@ static unsigned int __bcmgenet_tx_reclaim(struct net_device *dev,
 
 	/* Reclaim transmitted buffers */
 	while (txbds_processed < txbds_ready) {
-		skb = bcmgenet_free_tx_cb(&priv->pdev->dev,
-					  &priv->tx_cbs[ring->clean_ptr]);
+		cb = &priv->tx_cbs[ring->clean_ptr];
+		if (cb->xdpf) {
+			xdp_pkts++;
+			xdp_bytes += cb->xdpf->len;
+		}
+
+		skb = bcmgenet_free_tx_cb(&priv->pdev->dev, cb);
 		if (skb) {
 			pkts_compl++;
 			bytes_compl += GENET_CB(skb)->bytes_sent;
@@ -1867,9 +1913,10 @@ static unsigned int __bcmgenet_tx_reclaim(struct net_device *dev,
 	ring->free_bds += txbds_processed;
 	ring->c_index = c_index;
 
-	ring->packets += pkts_compl;
-	ring->bytes += bytes_compl;
+	ring->packets += pkts_compl + xdp_pkts;
+	ring->bytes += bytes_compl + xdp_bytes;
 
+	/* XDP frames bypass BQL, so only report the skbs to it */
 	netdev_tx_completed_queue(netdev_get_tx_queue(dev, ring->queue),
 				  pkts_compl, bytes_compl);
 
@@ -1989,6 +2036,114 @@ static struct sk_buff *bcmgenet_add_tsb(struct net_device *dev,
 	return skb;
 }
 
+/* Queue an XDP frame on the default Tx ring, which it shares with the
+ * stack. The frame is sent with a zeroed TSB and the doorbell is left to
+ * bcmgenet_xdp_tx_flush(). Frames from our own Rx page_pool (XDP_TX) are
+ * already mapped and only need syncing, anything else is mapped here.
+ */
+static int bcmgenet_xdp_xmit_frame(struct bcmgenet_priv *priv,
+				   struct xdp_frame *xdpf, bool dma_map)
+{
+	struct bcmgenet_tx_ring *ring = &priv->tx_rings[DESC_INDEX];
+	struct device *kdev = &priv->pdev->dev;
+	struct status_64 *status;
+	struct enet_cb *tx_cb_ptr;
+	struct netdev_queue *txq;
+	dma_addr_t mapping;
+	unsigned int size;
+	struct page *page;
+	u32 len_stat;
+	int ret = 0;
+
+	if (unlikely(xdpf->headroom < sizeof(*status)))
+		return -EINVAL;
+
+	spin_lock(&ring->lock);
+	/* Keep the reserve needed by the stack for a fully fragmented skb */
+	if (ring->free_bds <= (MAX_SKB_FRAGS + 1)) {
+		ret = -ENOSPC;
+		goto out;
+	}
+
+	status = xdpf->data - sizeof(*status);
+	memset(status, 0, sizeof(*status));
+	size = xdpf->len + sizeof(*status);
+
+	if (dma_map) {
+		mapping = dma_map_single(kdev, status, size, DMA_TO_DEVICE);
+		if (dma_mapping_error(kdev, mapping)) {
+			priv->mib.tx_dma_failed++;
+			ret = -ENOMEM;
+			goto out;
+		}
+	} else {
+		page = virt_to_page(status);
+		mapping = page_pool_get_dma_addr(page) +
+			  ((void *)status - page_address(page));
+		dma_sync_single_for_device(kdev, mapping, size,
+					   DMA_BIDIRECTIONAL);
+	}
+
+	tx_cb_ptr = bcmgenet_get_txcb(priv, ring);
+	dma_unmap_addr_set(tx_cb_ptr, dma_addr, dma_map ? mapping : 0);
+	dma_unmap_len_set(tx_cb_ptr, dma_len, size);
+	tx_cb_ptr->xdpf = xdpf;
+
+	len_stat = (size << DMA_BUFLENGTH_SHIFT) |
+		   (priv->hw_params->qtag_mask << DMA_TX_QTAG_SHIFT) |
+		   DMA_TX_APPEND_CRC | DMA_SOP | DMA_EOP;
+	dmadesc_set(priv, tx_cb_ptr->bd_addr, mapping, len_stat);
+
+	ring->free_bds--;
+	ring->prod_index++;
+	ring->prod_index &= DMA_P_INDEX_MASK;
+
+	if (ring->free_bds <= (MAX_SKB_FRAGS + 1)) {
+		txq = netdev_get_tx_queue(priv->dev, ring->queue);
+		netif_tx_stop_queue(txq);
+	}
+out:
+	spin_unlock(&ring->lock);
+
+	return ret;
+}
+
+static void bcmgenet_xdp_tx_flush(struct bcmgenet_priv *priv)
+{
+	struct bcmgenet_tx_ring *ring = &priv->tx_rings[DESC_INDEX];
+
+	spin_lock(&ring->lock);
+	bcmgenet_tdma_ring_writel(priv, ring->index,
+				  ring->prod_index, TDMA_PROD_INDEX);
+	spin_unlock(&ring->lock);
+}
+
+static int bcmgenet_xdp_xmit(struct net_device *dev, int num_frames,
+			     struct xdp_frame **frames, u32 flags)
+{
+	struct bcmgenet_priv *priv = netdev_priv(dev);
+	int drops = 0;
+	int i;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev)))
+		return -ENETDOWN;
+
+	for (i = 0; i < num_frames; i++) {
+		if (bcmgenet_xdp_xmit_frame(priv, frames[i], true)) {
+			xdp_return_frame_rx_napi(frames[i]);
+			drops++;
+		}
+	}
+
+	if (flags & XDP_XMIT_FLUSH)
+		bcmgenet_xdp_tx_flush(priv);
+
+	return num_frames - drops;
+}
+
 static netdev_tx_t bcmgenet_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct bcmgenet_priv *priv = netdev_priv(dev);
@@ -2111,6 +2266,8 @@ static netdev_tx_t bcmgenet_xmit(struct sk_buff *skb, struct net_device *dev)
 		/* Packets are ready, update producer index */
 		bcmgenet_tdma_ring_writel(priv, ring->index,
 					  ring->prod_index, TDMA_PROD_INDEX);
+	else
+		ring->doorbells_deferred++;
 out:
 	spin_unlock(&ring->lock);
 
@@ -2130,63 +2287,183 @@ static netdev_tx_t bcmgenet_xmit(struct sk_buff *skb, struct net_device *dev)
 	goto out;
 }
 
-static struct sk_buff *bcmgenet_rx_refill(struct bcmgenet_priv *priv,
-					  struct enet_cb *cb)
+static struct page *bcmgenet_rx_refill(struct bcmgenet_rx_ring *ring,
+				       struct enet_cb *cb)
 {
+	struct bcmgenet_priv *priv = ring->priv;
 	struct device *kdev = &priv->pdev->dev;
-	struct sk_buff *skb;
-	struct sk_buff *rx_skb;
+	struct page *rx_page;
+	struct page *page;
 	dma_addr_t mapping;
 
-	/* Allocate a new Rx skb */
-	skb = __netdev_alloc_skb(priv->dev, priv->rx_buf_len + SKB_ALIGNMENT,
-				 GFP_ATOMIC | __GFP_NOWARN);
-	if (!skb) {
+	/* Allocate a new, already DMA-mapped, Rx page */
+	page = page_pool_dev_alloc_pages(ring->page_pool);
+	if (!page) {
 		priv->mib.alloc_rx_buff_failed++;
 		netif_err(priv, rx_err, priv->dev,
-			  "%s: Rx skb allocation failed\n", __func__);
-		return NULL;
-	}
-
-	/* DMA-map the new Rx skb */
-	mapping = dma_map_single(kdev, skb->data, priv->rx_buf_len,
-				 DMA_FROM_DEVICE);
-	if (dma_mapping_error(kdev, mapping)) {
-		priv->mib.rx_dma_failed++;
-		dev_kfree_skb_any(skb);
-		netif_err(priv, rx_err, priv->dev,
-			  "%s: Rx skb DMA mapping failed\n", __func__);
+			  "%s: Rx page allocation failed\n", __func__);
 		return NULL;
 	}
+	mapping = page_pool_get_dma_addr(page) + GENET_RX_HEADROOM;
 
-	/* Grab the current Rx skb from the ring and DMA-unmap it */
-	rx_skb = bcmgenet_free_rx_cb(kdev, cb);
+	/* Grab the current Rx page from the ring and sync it for the CPU */
+	rx_page = bcmgenet_free_rx_cb(kdev, cb);
 
-	/* Put the new Rx skb on the ring */
-	cb->skb = skb;
+	/* Put the new Rx page on the ring */
+	cb->rx_page = page;
 	dma_unmap_addr_set(cb, dma_addr, mapping);
 	dma_unmap_len_set(cb, dma_len, priv->rx_buf_len);
 	dmadesc_set_addr(priv, cb->bd_addr, mapping);
 
-	/* Return the current Rx skb to caller */
-	return rx_skb;
+	/* Return the current Rx page to caller */
+	return rx_page;
 }
 
-/* bcmgenet_desc_rx - descriptor based rx process.
- * this could be called from bottom half, or from NAPI polling method.
+/* Zero-copy AF_XDP counterpart of bcmgenet_rx_refill(). Returns false,
+ * leaving the control block untouched, when the fill queue is empty.
  */
-static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
-				     unsigned int budget)
+static bool bcmgenet_rx_refill_xsk(struct bcmgenet_rx_ring *ring,
+				   struct enet_cb *cb)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct xdp_buff *xdp;
+	dma_addr_t mapping;
+
+	xdp = xsk_buff_alloc(ring->xsk_pool);
+	if (!xdp) {
+		priv->mib.alloc_rx_buff_failed++;
+		return false;
+	}
+	mapping = xsk_buff_xdp_get_dma(xdp);
+
+	cb->xsk_buff = xdp;
+	dma_unmap_addr_set(cb, dma_addr, mapping);
+	dmadesc_set_addr(priv, cb->bd_addr, mapping);
+
+	return true;
+}
+
+/* A BD can only be handed back to the hardware with a buffer on it. When
+ * the fill queue runs dry, the BDs behind c_index are left unarmed and the
+ * consumer index written to the hardware lags c_index by their count, so
+ * the DMA stops short of them. Arm them again, oldest first.
+ */
+static void bcmgenet_rx_rearm_xsk(struct bcmgenet_rx_ring *ring)
+{
+	unsigned int i;
+
+	while (ring->xsk_unarmed) {
+		i = ring->read_ptr - ring->cb_ptr + ring->size -
+		    ring->xsk_unarmed;
+		if (!bcmgenet_rx_refill_xsk(ring, ring->cbs + i % ring->size))
+			break;
+		ring->xsk_unarmed--;
+	}
+
+	if (xsk_uses_need_wakeup(ring->xsk_pool)) {
+		if (ring->xsk_unarmed)
+			xsk_set_rx_need_wakeup(ring->xsk_pool);
+		else
+			xsk_clear_rx_need_wakeup(ring->xsk_pool);
+	}
+}
+
+/* xdp_convert_buff_to_frame() copies a UMEM buffer with no headroom left
+ * for the TSB, so XDP_TX from a zero-copy ring makes its own copy.
+ */
+static struct xdp_frame *bcmgenet_xsk_buff_to_frame(struct xdp_buff *xdp)
+{
+	unsigned int len = xdp->data_end - xdp->data;
+	struct xdp_frame *xdpf;
+	struct page *page;
+
+	if (GENET_RX_HEADROOM + len > PAGE_SIZE)
+		return NULL;
+
+	page = dev_alloc_page();
+	if (!page)
+		return NULL;
+
+	xdpf = page_address(page);
+	memset(xdpf, 0, sizeof(*xdpf));
+	xdpf->data = (void *)xdpf + GENET_RX_HEADROOM;
+	memcpy(xdpf->data, xdp->data, len);
+	xdpf->len = len;
+	xdpf->headroom = GENET_RX_HEADROOM - sizeof(*xdpf);
+	xdpf->frame_sz = PAGE_SIZE;
+	xdpf->mem.type = MEM_TYPE_PAGE_ORDER0;
+
+	xsk_buff_free(xdp);
+
+	return xdpf;
+}
+
+/* Give an Rx buffer back to the pool it came from */
+static void bcmgenet_free_rx_xdp(struct bcmgenet_rx_ring *ring,
+				 struct xdp_buff *xdp)
+{
+	if (ring->xsk_pool)
+		xsk_buff_free(xdp);
+	else
+		page_pool_recycle_direct(ring->page_pool,
+					 virt_to_page(xdp->data_hard_start));
+}
+
+/* Run the XDP program on a received frame. Unless the verdict is XDP_PASS
+ * the buffer is consumed here, either queued for transmission or freed.
+ */
+static u32 bcmgenet_run_xdp(struct bcmgenet_rx_ring *ring,
+			    struct bpf_prog *prog, struct xdp_buff *xdp)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct xdp_frame *xdpf;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		break;
+	case XDP_TX:
+		if (ring->xsk_pool)
+			xdpf = bcmgenet_xsk_buff_to_frame(xdp);
+		else
+			xdpf = xdp_convert_buff_to_frame(xdp);
+		if (unlikely(!xdpf))
+			goto out_failure;
+		/* Copies made from a UMEM buffer still need mapping */
+		if (unlikely(bcmgenet_xdp_xmit_frame(priv, xdpf,
+						     !!ring->xsk_pool))) {
+			xdp_return_frame_rx_napi(xdpf);
+			goto out_exception;
+		}
+		break;
+	case XDP_REDIRECT:
+		if (unlikely(xdp_do_redirect(priv->dev, xdp, prog)))
+			goto out_failure;
+		break;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		bcmgenet_free_rx_xdp(ring, xdp);
+out_exception:
+		trace_xdp_exception(priv->dev, prog, act);
+		ring->dropped++;
+		break;
+	case XDP_DROP:
+		bcmgenet_free_rx_xdp(ring, xdp);
+		ring->dropped++;
+		break;
+	}
+
+	return act;
+}
+
+/* Clear the ring interrupt and return the hardware producer index */
+static unsigned int bcmgenet_rx_prod_index(struct bcmgenet_rx_ring *ring)
 {
 	struct bcmgenet_priv *priv = ring->priv;
-	struct net_device *dev = priv->dev;
-	struct enet_cb *cb;
-	struct sk_buff *skb;
-	u32 dma_length_status;
-	unsigned long dma_flag;
-	int len;
-	unsigned int rxpktprocessed = 0, rxpkttoprocess;
-	unsigned int bytes_processed = 0;
 	unsigned int p_index, mask;
 	unsigned int discards;
 
@@ -2218,32 +2495,127 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 		}
 	}
 
-	p_index &= DMA_P_INDEX_MASK;
+	return p_index & DMA_P_INDEX_MASK;
+}
+
+/* Check the DMA flags of a received frame, accounting any error */
+static bool bcmgenet_rx_frame_ok(struct bcmgenet_rx_ring *ring,
+				 unsigned long dma_flag)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct net_device *dev = priv->dev;
+
+	if (unlikely(!(dma_flag & DMA_EOP) || !(dma_flag & DMA_SOP))) {
+		netif_err(priv, rx_status, dev,
+			  "dropping fragmented packet!\n");
+		ring->errors++;
+		return false;
+	}
+
+	/* report errors */
+	if (unlikely(dma_flag & (DMA_RX_CRC_ERROR |
+					DMA_RX_OV |
+					DMA_RX_NO |
+					DMA_RX_LG |
+					DMA_RX_RXER))) {
+		netif_err(priv, rx_status, dev, "dma_flag=0x%x\n",
+			  (unsigned int)dma_flag);
+		if (dma_flag & DMA_RX_CRC_ERROR)
+			dev->stats.rx_crc_errors++;
+		if (dma_flag & DMA_RX_OV)
+			dev->stats.rx_over_errors++;
+		if (dma_flag & DMA_RX_NO)
+			dev->stats.rx_frame_errors++;
+		if (dma_flag & DMA_RX_LG)
+			dev->stats.rx_length_errors++;
+		dev->stats.rx_errors++;
+		return false;
+	} /* error packet */
+
+	return true;
+}
+
+/* Finish setting up a received skb and send it to the kernel */
+static void bcmgenet_rx_skb(struct bcmgenet_rx_ring *ring,
+			    struct sk_buff *skb, unsigned long dma_flag,
+			    bool rx_csum_valid, __be16 rx_csum)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct net_device *dev = priv->dev;
+	unsigned int len = skb->len;
+
+	if (rx_csum_valid) {
+		skb->csum = (__force __wsum)ntohs(rx_csum);
+		skb->ip_summed = CHECKSUM_COMPLETE;
+	}
+
+	skb_record_rx_queue(skb, ring->queue);
+	skb->protocol = eth_type_trans(skb, dev);
+	ring->packets++;
+	ring->bytes += len;
+	if (dma_flag & DMA_RX_MULT)
+		dev->stats.multicast++;
+
+	/* Notify kernel */
+	napi_gro_receive(&ring->napi, skb);
+	netif_dbg(priv, rx_status, dev, "pushed up to kernel\n");
+}
+
+/* bcmgenet_desc_rx - descriptor based rx process.
+ * this could be called from bottom half, or from NAPI polling method.
+ */
+static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
+				     unsigned int budget)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct net_device *dev = priv->dev;
+	struct enet_cb *cb;
+	struct sk_buff *skb;
+	struct bpf_prog *xdp_prog;
+	struct xdp_buff xdp;
+	bool xdp_redirect = false;
+	bool xdp_tx = false;
+	u32 dma_length_status;
+	unsigned long dma_flag;
+	int len;
+	unsigned int rxpktprocessed = 0, rxpkttoprocess;
+	unsigned int bytes_processed = 0;
+	unsigned int p_index;
+	struct page *page;
+	void *data, *buf;
+
+	p_index = bcmgenet_rx_prod_index(ring);
 	rxpkttoprocess = (p_index - ring->c_index) & DMA_C_INDEX_MASK;
 
 	netif_dbg(priv, rx_status, dev,
 		  "RDMA: rxpkttoprocess=%d\n", rxpkttoprocess);
 
+	rcu_read_lock();
+	xdp_prog = READ_ONCE(priv->xdp_prog);
+	xdp.rxq = &ring->xdp_rxq;
+	xdp.frame_sz = PAGE_SIZE;
+
 	while ((rxpktprocessed < rxpkttoprocess) &&
 	       (rxpktprocessed < budget)) {
 		struct status_64 *status;
-		__be16 rx_csum;
+		bool rx_csum_valid;
+		__be16 rx_csum = 0;
 
 		cb = &priv->rx_cbs[ring->read_ptr];
-		skb = bcmgenet_rx_refill(priv, cb);
+		page = bcmgenet_rx_refill(ring, cb);
 
-		if (unlikely(!skb)) {
+		if (unlikely(!page)) {
 			ring->dropped++;
 			goto next;
 		}
+		buf = page_address(page);
 
-		status = (struct status_64 *)skb->data;
+		/* The RSB may be overwritten by the XDP program, read it now */
+		status = (struct status_64 *)(buf + GENET_RX_HEADROOM);
 		dma_length_status = status->length_status;
-		if (dev->features & NETIF_F_RXCSUM) {
+		rx_csum_valid = dev->features & NETIF_F_RXCSUM;
+		if (rx_csum_valid)
 			rx_csum = (__force __be16)(status->rx_csum & 0xffff);
-			skb->csum = (__force __wsum)ntohs(rx_csum);
-			skb->ip_summed = CHECKSUM_COMPLETE;
-		}
 
 		/* DMA flags and length are still valid no matter how
 		 * we got the Receive Status Vector (64B RSB or register)
@@ -2256,58 +2628,191 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 			  __func__, p_index, ring->c_index,
 			  ring->read_ptr, dma_length_status);
 
-		if (unlikely(!(dma_flag & DMA_EOP) || !(dma_flag & DMA_SOP))) {
-			netif_err(priv, rx_status, dev,
-				  "dropping fragmented packet!\n");
-			ring->errors++;
-			dev_kfree_skb_any(skb);
+		if (unlikely(!bcmgenet_rx_frame_ok(ring, dma_flag))) {
+			page_pool_recycle_direct(ring->page_pool, page);
 			goto next;
 		}
 
-		/* report errors */
-		if (unlikely(dma_flag & (DMA_RX_CRC_ERROR |
-						DMA_RX_OV |
-						DMA_RX_NO |
-						DMA_RX_LG |
-						DMA_RX_RXER))) {
-			netif_err(priv, rx_status, dev, "dma_flag=0x%x\n",
-				  (unsigned int)dma_flag);
-			if (dma_flag & DMA_RX_CRC_ERROR)
-				dev->stats.rx_crc_errors++;
-			if (dma_flag & DMA_RX_OV)
-				dev->stats.rx_over_errors++;
-			if (dma_flag & DMA_RX_NO)
-				dev->stats.rx_frame_errors++;
-			if (dma_flag & DMA_RX_LG)
-				dev->stats.rx_length_errors++;
-			dev->stats.rx_errors++;
-			dev_kfree_skb_any(skb);
+		/* remove RSB and hardware 2bytes added for IP alignment */
+		data = (void *)status + 66;
+		len -= 66;
+
+		if (priv->crc_fwd_en)
+			len -= ETH_FCS_LEN;
+
+		if (xdp_prog) {
+			u32 act;
+
+			xdp.data_hard_start = buf;
+			xdp.data = data;
+			xdp.data_end = data + len;
+			xdp_set_data_meta_invalid(&xdp);
+
+			act = bcmgenet_run_xdp(ring, xdp_prog, &xdp);
+			if (act != XDP_PASS) {
+				xdp_tx |= act == XDP_TX;
+				xdp_redirect |= act == XDP_REDIRECT;
+				bytes_processed += len;
+				goto next;
+			}
+
+			/* The hardware checksum no longer covers the frame */
+			if (xdp.data != data || xdp.data_end != data + len)
+				rx_csum_valid = false;
+
+			data = xdp.data;
+			len = xdp.data_end - xdp.data;
+		}
+
+		if (len <= GENET_RX_COPYBREAK) {
+			skb = napi_alloc_skb(&ring->napi, len);
+			if (likely(skb))
+				skb_put_data(skb, data, len);
+			page_pool_recycle_direct(ring->page_pool, page);
+		} else {
+			skb = build_skb(buf, PAGE_SIZE);
+			if (likely(skb)) {
+				skb_reserve(skb, data - buf);
+				skb_put(skb, len);
+				/* The stack frees the page, unmap it */
+				page_pool_release_page(ring->page_pool, page);
+			} else {
+				page_pool_recycle_direct(ring->page_pool,
+							 page);
+			}
+		}
+
+		if (unlikely(!skb)) {
+			priv->mib.alloc_rx_buff_failed++;
+			ring->dropped++;
 			goto next;
-		} /* error packet */
+		}
+
+		bytes_processed += len;
+		bcmgenet_rx_skb(ring, skb, dma_flag, rx_csum_valid, rx_csum);
+
+next:
+		rxpktprocessed++;
+		if (likely(ring->read_ptr < ring->end_ptr))
+			ring->read_ptr++;
+		else
+			ring->read_ptr = ring->cb_ptr;
+
+		ring->c_index = (ring->c_index + 1) & DMA_C_INDEX_MASK;
+		bcmgenet_rdma_ring_writel(priv, ring->index, ring->c_index, RDMA_CONS_INDEX);
+	}
+
+	if (xdp_tx)
+		bcmgenet_xdp_tx_flush(priv);
+	if (xdp_redirect)
+		xdp_do_flush();
+	rcu_read_unlock();
+
+	ring->dim.bytes = bytes_processed;
+	ring->dim.packets = rxpktprocessed;
+
+	return rxpktprocessed;
+}
+
+/* Zero-copy AF_XDP counterpart of bcmgenet_desc_rx(). Frames land straight
+ * in UMEM buffers. Those the XDP program does not redirect to the socket are
+ * copied out, and the buffer goes back to the pool.
+ */
+static unsigned int bcmgenet_desc_rx_xsk(struct bcmgenet_rx_ring *ring,
+					 unsigned int budget)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct net_device *dev = priv->dev;
+	unsigned int rxpktprocessed = 0, rxpkttoprocess;
+	unsigned int bytes_processed = 0;
+	struct bpf_prog *xdp_prog;
+	bool xdp_redirect = false;
+	bool xdp_tx = false;
+	u32 dma_length_status;
+	unsigned long dma_flag;
+	struct xdp_buff *xdp;
+	struct sk_buff *skb;
+	struct enet_cb *cb;
+	void *data;
+	int len;
+
+	rxpkttoprocess = (bcmgenet_rx_prod_index(ring) - ring->c_index) &
+			 DMA_C_INDEX_MASK;
+
+	bcmgenet_rx_rearm_xsk(ring);
+
+	rcu_read_lock();
+	xdp_prog = READ_ONCE(priv->xdp_prog);
+
+	while ((rxpktprocessed < rxpkttoprocess) &&
+	       (rxpktprocessed < budget)) {
+		struct status_64 *status;
+		bool rx_csum_valid;
+		__be16 rx_csum = 0;
+		u32 act = XDP_PASS;
+
+		cb = &priv->rx_cbs[ring->read_ptr];
+		xdp = cb->xsk_buff;
+		xsk_buff_dma_sync_for_cpu(xdp, ring->xsk_pool);
 
-		skb_put(skb, len);
+		/* Once a BD is left unarmed, all the following ones are too */
+		if (ring->xsk_unarmed || !bcmgenet_rx_refill_xsk(ring, cb)) {
+			cb->xsk_buff = NULL;
+			ring->xsk_unarmed++;
+		}
+
+		status = xdp->data;
+		dma_length_status = status->length_status;
+		rx_csum_valid = dev->features & NETIF_F_RXCSUM;
+		if (rx_csum_valid)
+			rx_csum = (__force __be16)(status->rx_csum & 0xffff);
+
+		dma_flag = dma_length_status & 0xffff;
+		len = dma_length_status >> DMA_BUFLENGTH_SHIFT;
+
+		if (unlikely(!bcmgenet_rx_frame_ok(ring, dma_flag))) {
+			xsk_buff_free(xdp);
+			goto next;
+		}
 
 		/* remove RSB and hardware 2bytes added for IP alignment */
-		skb_pull(skb, 66);
+		data = (void *)status + 66;
 		len -= 66;
 
-		if (priv->crc_fwd_en) {
-			skb_trim(skb, len - ETH_FCS_LEN);
+		if (priv->crc_fwd_en)
 			len -= ETH_FCS_LEN;
+
+		xdp->data = data;
+		xdp->data_meta = data;
+		xdp->data_end = data + len;
+
+		if (xdp_prog)
+			act = bcmgenet_run_xdp(ring, xdp_prog, xdp);
+		if (act != XDP_PASS) {
+			xdp_tx |= act == XDP_TX;
+			xdp_redirect |= act == XDP_REDIRECT;
+			bytes_processed += len;
+			goto next;
 		}
 
-		bytes_processed += len;
+		/* The hardware checksum no longer covers the frame */
+		if (xdp->data != data || xdp->data_end != data + len)
+			rx_csum_valid = false;
+
+		len = xdp->data_end - xdp->data;
+		skb = napi_alloc_skb(&ring->napi, len);
+		if (likely(skb))
+			skb_put_data(skb, xdp->data, len);
+		xsk_buff_free(xdp);
 
-		/*Finish setting up the received SKB and send it to the kernel*/
-		skb->protocol = eth_type_trans(skb, priv->dev);
-		ring->packets++;
-		ring->bytes += len;
-		if (dma_flag & DMA_RX_MULT)
-			dev->stats.multicast++;
+		if (unlikely(!skb)) {
+			priv->mib.alloc_rx_buff_failed++;
+			ring->dropped++;
+			goto next;
+		}
 
-		/* Notify kernel */
-		napi_gro_receive(&ring->napi, skb);
-		netif_dbg(priv, rx_status, dev, "pushed up to kernel\n");
+		bytes_processed += len;
+		bcmgenet_rx_skb(ring, skb, dma_flag, rx_csum_valid, rx_csum);
 
 next:
 		rxpktprocessed++;
@@ -2317,9 +2822,21 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 			ring->read_ptr = ring->cb_ptr;
 
 		ring->c_index = (ring->c_index + 1) & DMA_C_INDEX_MASK;
-		bcmgenet_rdma_ring_writel(priv, ring->index, ring->c_index, RDMA_CONS_INDEX);
 	}
 
+	bcmgenet_rdma_ring_writel(priv, ring->index,
+				  (ring->c_index - ring->xsk_unarmed) &
+				  DMA_C_INDEX_MASK, RDMA_CONS_INDEX);
+
+	if (ring->xsk_unarmed && xsk_uses_need_wakeup(ring->xsk_pool))
+		xsk_set_rx_need_wakeup(ring->xsk_pool);
+
+	if (xdp_tx)
+		bcmgenet_xdp_tx_flush(priv);
+	if (xdp_redirect)
+		xdp_do_flush();
+	rcu_read_unlock();
+
 	ring->dim.bytes = bytes_processed;
 	ring->dim.packets = rxpktprocessed;
 
@@ -2334,7 +2851,17 @@ static int bcmgenet_rx_poll(struct napi_struct *napi, int budget)
 	struct dim_sample dim_sample = {};
 	unsigned int work_done;
 
-	work_done = bcmgenet_desc_rx(ring, budget);
+	if (ring->xsk_pool) {
+		work_done = bcmgenet_desc_rx_xsk(ring, budget);
+		/* Without need_wakeup nothing tells us the fill queue has
+		 * been refilled, so keep polling until every BD is armed.
+		 */
+		if (ring->xsk_unarmed &&
+		    !xsk_uses_need_wakeup(ring->xsk_pool))
+			work_done = budget;
+	} else {
+		work_done = bcmgenet_desc_rx(ring, budget);
+	}
 
 	if (work_done < budget) {
 		napi_complete_done(napi, work_done);
@@ -2369,18 +2896,25 @@ static int bcmgenet_alloc_rx_buffers(struct bcmgenet_priv *priv,
 				     struct bcmgenet_rx_ring *ring)
 {
 	struct enet_cb *cb;
-	struct sk_buff *skb;
+	struct page *page;
 	int i;
 
 	netif_dbg(priv, hw, priv->dev, "%s\n", __func__);
 
+	/* The fill queue may not hold a full ring yet, arm what it can */
+	if (ring->xsk_pool) {
+		ring->xsk_unarmed = ring->size;
+		bcmgenet_rx_rearm_xsk(ring);
+		return 0;
+	}
+
 	/* loop here for each buffer needing assign */
 	for (i = 0; i < ring->size; i++) {
 		cb = ring->cbs + i;
-		skb = bcmgenet_rx_refill(priv, cb);
-		if (skb)
-			dev_consume_skb_any(skb);
-		if (!cb->skb)
+		page = bcmgenet_rx_refill(ring, cb);
+		if (page)
+			page_pool_put_full_page(ring->page_pool, page, false);
+		if (!cb->rx_page)
 			return -ENOMEM;
 	}
 
@@ -2389,19 +2923,74 @@ static int bcmgenet_alloc_rx_buffers(struct bcmgenet_priv *priv,
 
 static void bcmgenet_free_rx_buffers(struct bcmgenet_priv *priv)
 {
-	struct sk_buff *skb;
+	struct bcmgenet_rx_ring *ring;
 	struct enet_cb *cb;
-	int i;
+	struct page *page;
+	int i, j;
 
-	for (i = 0; i < priv->num_rx_bds; i++) {
-		cb = &priv->rx_cbs[i];
+	for (i = 0; i <= DESC_INDEX; i++) {
+		ring = &priv->rx_rings[i];
 
-		skb = bcmgenet_free_rx_cb(&priv->pdev->dev, cb);
-		if (skb)
-			dev_consume_skb_any(skb);
+		/* Zero-copy rings are filled once their rxq is registered */
+		if (ring->xsk_pool) {
+			if (!xdp_rxq_info_is_reg(&ring->xdp_rxq))
+				continue;
+
+			for (j = 0; j < ring->size; j++) {
+				cb = ring->cbs + j;
+				if (cb->xsk_buff)
+					xsk_buff_free(cb->xsk_buff);
+				cb->xsk_buff = NULL;
+			}
+
+			xdp_rxq_info_unreg(&ring->xdp_rxq);
+			continue;
+		}
+
+		/* Only rings initialized since the last open own a pool */
+		if (!ring->page_pool)
+			continue;
+
+		for (j = 0; j < ring->size; j++) {
+			page = bcmgenet_free_rx_cb(&priv->pdev->dev,
+						   ring->cbs + j);
+			if (page)
+				page_pool_put_full_page(ring->page_pool, page,
+							false);
+		}
+
+		if (xdp_rxq_info_is_reg(&ring->xdp_rxq))
+			xdp_rxq_info_unreg(&ring->xdp_rxq);
+		page_pool_destroy(ring->page_pool);
+		ring->page_pool = NULL;
 	}
 }
 
+static int bcmgenet_create_page_pool(struct bcmgenet_rx_ring *ring)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct page_pool_params pp_params = {
+		.order = 0,
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = ring->size,
+		.nid = NUMA_NO_NODE,
+		.dev = &priv->pdev->dev,
+		/* XDP_TX transmits straight out of the Rx pages */
+		.dma_dir = DMA_BIDIRECTIONAL,
+		.offset = GENET_RX_HEADROOM,
+		.max_len = priv->rx_buf_len,
+	};
+	struct page_pool *pool;
+
+	pool = page_pool_create(&pp_params);
+	if (IS_ERR(pool))
+		return PTR_ERR(pool);
+
+	ring->page_pool = pool;
+
+	return 0;
+}
+
 static void umac_enable_set(struct bcmgenet_priv *priv, u32 mask, bool enable)
 {
 	u32 reg;
@@ -2602,7 +3191,7 @@ static void bcmgenet_init_tx_ring(struct bcmgenet_priv *priv,
 
 	bcmgenet_tdma_ring_writel(priv, index, 0, TDMA_PROD_INDEX);
 	bcmgenet_tdma_ring_writel(priv, index, 0, TDMA_CONS_INDEX);
-	bcmgenet_tdma_ring_writel(priv, index, 10, DMA_MBUF_DONE_THRESH);
+	bcmgenet_set_tx_coalesce(ring, ring->tx_max_coalesced_frames);
 	/* Disable rate control for now */
 	bcmgenet_tdma_ring_writel(priv, index, flow_period_val,
 				  TDMA_FLOW_PERIOD);
@@ -2632,14 +3221,20 @@ static int bcmgenet_init_rx_ring(struct bcmgenet_priv *priv,
 {
 	struct bcmgenet_rx_ring *ring = &priv->rx_rings[index];
 	u32 words_per_bd = WORDS_PER_BD(priv);
+	u32 buf_len;
 	int ret;
 
 	ring->priv = priv;
 	ring->index = index;
+	/* Match the queue numbering of ethtool Rx flow steering and Tx:
+	 * queue 0 is the default ring 16, queue N priority ring N - 1.
+	 */
 	if (index == DESC_INDEX) {
+		ring->queue = 0;
 		ring->int_enable = bcmgenet_rx_ring16_int_enable;
 		ring->int_disable = bcmgenet_rx_ring16_int_disable;
 	} else {
+		ring->queue = index + 1;
 		ring->int_enable = bcmgenet_rx_ring_int_enable;
 		ring->int_disable = bcmgenet_rx_ring_int_disable;
 	}
@@ -2649,6 +3244,35 @@ static int bcmgenet_init_rx_ring(struct bcmgenet_priv *priv,
 	ring->read_ptr = start_ptr;
 	ring->cb_ptr = start_ptr;
 	ring->end_ptr = end_ptr - 1;
+	ring->xsk_unarmed = 0;
+
+	if (!ring->xsk_pool) {
+		ret = bcmgenet_create_page_pool(ring);
+		if (ret)
+			return ret;
+	}
+
+	/* This is the queue id AF_XDP sockets bind to */
+	ret = xdp_rxq_info_reg(&ring->xdp_rxq, priv->dev, ring->queue);
+	if (ret)
+		return ret;
+
+	if (ring->xsk_pool) {
+		ret = xdp_rxq_info_reg_mem_model(&ring->xdp_rxq,
+						 MEM_TYPE_XSK_BUFF_POOL, NULL);
+		if (ret)
+			return ret;
+		xsk_pool_set_rxq_info(ring->xsk_pool, &ring->xdp_rxq);
+		buf_len = min_t(u32, RX_BUF_LENGTH,
+				xsk_pool_get_rx_frame_size(ring->xsk_pool));
+	} else {
+		ret = xdp_rxq_info_reg_mem_model(&ring->xdp_rxq,
+						 MEM_TYPE_PAGE_POOL,
+						 ring->page_pool);
+		if (ret)
+			return ret;
+		buf_len = RX_BUF_LENGTH;
+	}
 
 	ret = bcmgenet_alloc_rx_buffers(priv, ring);
 	if (ret)
@@ -2662,10 +3286,12 @@ static int bcmgenet_init_rx_ring(struct bcmgenet_priv *priv,
 		       NAPI_POLL_WEIGHT);
 
 	bcmgenet_rdma_ring_writel(priv, index, 0, RDMA_PROD_INDEX);
-	bcmgenet_rdma_ring_writel(priv, index, 0, RDMA_CONS_INDEX);
+	bcmgenet_rdma_ring_writel(priv, index,
+				  -ring->xsk_unarmed & DMA_C_INDEX_MASK,
+				  RDMA_CONS_INDEX);
 	bcmgenet_rdma_ring_writel(priv, index,
 				  ((size << DMA_RING_SIZE_SHIFT) |
-				   RX_BUF_LENGTH), DMA_RING_BUF_SIZE);
+				   buf_len), DMA_RING_BUF_SIZE);
 	bcmgenet_rdma_ring_writel(priv, index,
 				  (DMA_FC_THRESH_LO <<
 				   DMA_XOFF_THRESHOLD_SHIFT) |
@@ -3668,6 +4294,120 @@ static int bcmgenet_change_carrier(struct net_device *dev, bool new_carrier)
 	return 0;
 }
 
+static int bcmgenet_xdp_setup(struct net_device *dev, struct bpf_prog *prog)
+{
+	struct bcmgenet_priv *priv = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+
+	/* Rx buffers are always XDP capable, so the program can be swapped
+	 * without reinitializing the rings.
+	 */
+	old_prog = xchg(&priv->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+/* Queue 0 is the default ring, queue N priority ring N - 1 */
+static struct bcmgenet_rx_ring *
+bcmgenet_qid_to_rx_ring(struct bcmgenet_priv *priv, u32 qid)
+{
+	if (qid > priv->hw_params->rx_queues)
+		return NULL;
+
+	return &priv->rx_rings[qid ? qid - 1 : DESC_INDEX];
+}
+
+static int bcmgenet_xsk_pool_setup(struct net_device *dev,
+				   struct xsk_buff_pool *pool, u16 qid)
+{
+	struct bcmgenet_priv *priv = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct xsk_buff_pool *old_pool;
+	struct bcmgenet_rx_ring *ring;
+	int ret;
+
+	ring = bcmgenet_qid_to_rx_ring(priv, qid);
+	if (!ring)
+		return -EINVAL;
+
+	old_pool = ring->xsk_pool;
+	if (pool) {
+		if (old_pool)
+			return -EBUSY;
+		if (xsk_pool_get_rx_frame_size(pool) < GENET_XSK_RX_MIN_LEN)
+			return -EINVAL;
+
+		ret = xsk_pool_dma_map(pool, &priv->pdev->dev, 0);
+		if (ret)
+			return ret;
+	} else if (!old_pool) {
+		return 0;
+	}
+
+	/* The rings are only laid out at open, so switching one between
+	 * page_pool and UMEM buffers takes a full restart.
+	 */
+	if (running)
+		bcmgenet_close(dev);
+
+	ring->xsk_pool = pool;
+	if (old_pool)
+		xsk_pool_dma_unmap(old_pool, 0);
+
+	if (!running)
+		return 0;
+
+	ret = bcmgenet_open(dev);
+	if (ret && pool) {
+		/* Bring the interface back up without the pool */
+		ring->xsk_pool = NULL;
+		xsk_pool_dma_unmap(pool, 0);
+		if (bcmgenet_open(dev))
+			netdev_err(dev, "failed to restart after XSK setup\n");
+	}
+
+	return ret;
+}
+
+static int bcmgenet_xsk_wakeup(struct net_device *dev, u32 qid, u32 flags)
+{
+	struct bcmgenet_priv *priv = netdev_priv(dev);
+	struct bcmgenet_rx_ring *ring;
+
+	if (!netif_running(dev))
+		return -ENETDOWN;
+
+	/* Only the Rx side is zero-copy capable */
+	if (flags & XDP_WAKEUP_TX)
+		return -EOPNOTSUPP;
+
+	ring = bcmgenet_qid_to_rx_ring(priv, qid);
+	if (!ring || !ring->xsk_pool)
+		return -ENXIO;
+
+	if (napi_schedule_prep(&ring->napi)) {
+		ring->int_disable(ring);
+		__napi_schedule(&ring->napi);
+	}
+
+	return 0;
+}
+
+static int bcmgenet_bpf(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return bcmgenet_xdp_setup(dev, xdp->prog);
+	case XDP_SETUP_XSK_POOL:
+		return bcmgenet_xsk_pool_setup(dev, xdp->xsk.pool,
+					       xdp->xsk.queue_id);
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct net_device_ops bcmgenet_netdev_ops = {
 	.ndo_open		= bcmgenet_open,
 	.ndo_stop		= bcmgenet_close,
@@ -3682,6 +4422,9 @@ static const struct net_device_ops bcmgenet_netdev_ops = {
 #endif
 	.ndo_get_stats		= bcmgenet_get_stats,
 	.ndo_change_carrier	= bcmgenet_change_carrier,
+	.ndo_bpf		= bcmgenet_bpf,
+	.ndo_xdp_xmit		= bcmgenet_xdp_xmit,
+	.ndo_xsk_wakeup		= bcmgenet_xsk_wakeup,
 };
 
 /* Array of GENET hardware parameters/characteristics */
@@ -4080,6 +4823,9 @@ static int bcmgenet_probe(struct platform_device *pdev)
 	}
 	priv->rx_rings[DESC_INDEX].rx_max_coalesced_frames = 1;
 	priv->rx_rings[DESC_INDEX].rx_coalesce_usecs = 50;
+	for (i = 0; i < priv->hw_params->tx_queues; i++)
+		priv->tx_rings[i].tx_max_coalesced_frames = 10;
+	priv->tx_rings[DESC_INDEX].tx_max_coalesced_frames = 10;
 
 	/* libphy will determine the link state */
 	netif_carrier_off(dev);
@@ -15,6 +15,7 @@
 #include <linux/phy.h>
 #include <linux/dim.h>
 #include <linux/ethtool.h>
+#include <net/xdp.h>
 
 /* total number of Buffer Descriptors, same for Rx/Tx */
 #define TOTAL_DESC				256
@@ -494,6 +495,9 @@ struct bcmgenet_mib_counters {
 
 struct enet_cb {
 	struct sk_buff      *skb;
+	struct page	    *rx_page;	/* Rx page_pool page */
+	struct xdp_buff	    *xsk_buff;	/* Rx AF_XDP zero-copy buffer */
+	struct xdp_frame    *xdpf;	/* Tx XDP frame */
 	void __iomem *bd_addr;
 	DEFINE_DMA_UNMAP_ADDR(dma_addr);
 	DEFINE_DMA_UNMAP_LEN(dma_len);
@@ -566,6 +570,7 @@ struct bcmgenet_tx_ring {
 	struct napi_struct napi;	/* NAPI per tx queue */
 	unsigned long	packets;
 	unsigned long	bytes;
+	unsigned long	doorbells_deferred;
 	unsigned int	index;		/* ring index */
 	unsigned int	queue;		/* queue index */
 	struct enet_cb	*cbs;		/* tx ring buffer control block*/
@@ -577,6 +582,7 @@ struct bcmgenet_tx_ring {
 	unsigned int	prod_index;	/* Tx ring producer index SW copy */
 	unsigned int	cb_ptr;		/* Tx ring initial CB ptr */
 	unsigned int	end_ptr;	/* Tx ring end CB ptr */
+	u32		tx_max_coalesced_frames;
 	void (*int_enable)(struct bcmgenet_tx_ring *);
 	void (*int_disable)(struct bcmgenet_tx_ring *);
 	struct bcmgenet_priv *priv;
@@ -597,6 +603,7 @@ struct bcmgenet_rx_ring {
 	unsigned long	errors;
 	unsigned long	dropped;
 	unsigned int	index;		/* Rx ring index */
+	unsigned int	queue;		/* Rx queue index */
 	struct enet_cb	*cbs;		/* Rx ring buffer control block */
 	unsigned int	size;		/* Rx ring size */
 	unsigned int	c_index;	/* Rx last consumer index */
@@ -610,6 +617,10 @@ struct bcmgenet_rx_ring {
 	void (*int_enable)(struct bcmgenet_rx_ring *);
 	void (*int_disable)(struct bcmgenet_rx_ring *);
 	struct bcmgenet_priv *priv;
+	struct page_pool *page_pool;
+	struct xdp_rxq_info xdp_rxq;
+	struct xsk_buff_pool *xsk_pool;	/* zero-copy AF_XDP pool, if bound */
+	unsigned int	xsk_unarmed;	/* BDs behind c_index with no buffer */
 };
 
 enum bcmgenet_rxnfc_state {
@@ -642,6 +653,7 @@ struct bcmgenet_priv {
 	struct enet_cb *rx_cbs;
 	unsigned int num_rx_bds;
 	unsigned int rx_buf_len;
+	struct bpf_prog *xdp_prog;
 	struct bcmgenet_rxnfc_rule rxnfc_rules[MAX_NUM_OF_FS_RULES];
 	struct list_head rxnfc_list;
 
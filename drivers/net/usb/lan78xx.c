@@ -374,7 +374,7 @@ struct lan78xx_net {
 	struct sk_buff_head	rxq_pause;
 	struct sk_buff_head	txq_pend;
 
-	struct tasklet_struct	bh;
+	struct napi_struct	napi;
 	struct delayed_work	wq;
 
 	int			msg_enable;
@@ -1169,6 +1169,17 @@ static int lan78xx_update_flowcontrol(struct lan78xx_net *dev, u8 duplex,
 	return 0;
 }
 
+/* Kick NAPI from process context. Bottom halves have to be disabled around
+ * napi_schedule() there, or the raised softirq is not run until the next
+ * interrupt.
+ */
+static void lan78xx_napi_schedule(struct lan78xx_net *dev)
+{
+	local_bh_disable();
+	napi_schedule(&dev->napi);
+	local_bh_enable();
+}
+
 static int lan78xx_link_reset(struct lan78xx_net *dev)
 {
 	struct phy_device *phydev = dev->net->phydev;
@@ -1244,7 +1255,7 @@ static int lan78xx_link_reset(struct lan78xx_net *dev)
 				  jiffies + STAT_UPDATE_TIMER);
 		}
 
-		tasklet_schedule(&dev->bh);
+		lan78xx_napi_schedule(dev);
 	}
 
 	return ret;
@@ -2316,7 +2327,7 @@ static int lan78xx_change_mtu(struct net_device *netdev, int new_mtu)
 		if (dev->rx_urb_size > old_rx_urb_size) {
 			if (netif_running(dev->net)) {
 				unlink_urbs(dev, &dev->rxq);
-				tasklet_schedule(&dev->bh);
+				lan78xx_napi_schedule(dev);
 			}
 		}
 	}
@@ -2682,6 +2693,7 @@ static int lan78xx_open(struct net_device *net)
 
 	set_bit(EVENT_DEV_OPEN, &dev->flags);
 
+	napi_enable(&dev->napi);
 	netif_start_queue(net);
 
 	dev->link_on = false;
@@ -2750,7 +2762,7 @@ static int lan78xx_stop(struct net_device *net)
 	 */
 	dev->flags = 0;
 	cancel_delayed_work_sync(&dev->wq);
-	tasklet_kill(&dev->bh);
+	napi_disable(&dev->napi);
 
 	usb_autopm_put_interface(dev->intf);
 
@@ -2816,7 +2828,7 @@ static enum skb_state defer_bh(struct lan78xx_net *dev, struct sk_buff *skb,
 
 	__skb_queue_tail(&dev->done, skb);
 	if (skb_queue_len(&dev->done) == 1)
-		tasklet_schedule(&dev->bh);
+		napi_schedule(&dev->napi);
 	spin_unlock_irqrestore(&dev->done.lock, flags);
 
 	return old_state;
@@ -2895,7 +2907,7 @@ lan78xx_start_xmit(struct sk_buff *skb, struct net_device *net)
 		dev->net->stats.tx_dropped++;
 	}
 
-	tasklet_schedule(&dev->bh);
+	napi_schedule(&dev->napi);
 
 	return NETDEV_TX_OK;
 }
@@ -3039,8 +3051,6 @@ static void lan78xx_rx_vlan_offload(struct lan78xx_net *dev,
 
 static void lan78xx_skb_return(struct lan78xx_net *dev, struct sk_buff *skb)
 {
-	int status;
-
 	if (test_bit(EVENT_RX_PAUSED, &dev->flags)) {
 		skb_queue_tail(&dev->rxq_pause, skb);
 		return;
@@ -3058,10 +3068,7 @@ static void lan78xx_skb_return(struct lan78xx_net *dev, struct sk_buff *skb)
 	if (skb_defer_rx_timestamp(skb))
 		return;
 
-	status = netif_rx(skb);
-	if (status != NET_RX_SUCCESS)
-		netif_dbg(dev, rx_err, dev->net,
-			  "netif_rx status %d\n", status);
+	napi_gro_receive(&dev->napi, skb);
 }
 
 static int lan78xx_rx(struct lan78xx_net *dev, struct sk_buff *skb)
@@ -3202,7 +3209,7 @@ static int rx_submit(struct lan78xx_net *dev, struct urb *urb, gfp_t flags)
 		default:
 			netif_dbg(dev, rx_err, dev->net,
 				  "rx submit, %d\n", ret);
-			tasklet_schedule(&dev->bh);
+			napi_schedule(&dev->napi);
 		}
 	} else {
 		netif_dbg(dev, ifdown, dev->net, "rx: stopped\n");
@@ -3430,24 +3437,25 @@ static void lan78xx_rx_bh(struct lan78xx_net *dev)
 		}
 
 		if (skb_queue_len(&dev->rxq) < dev->rx_qlen)
-			tasklet_schedule(&dev->bh);
+			napi_schedule(&dev->napi);
 	}
 	if (skb_queue_len(&dev->txq) < dev->tx_qlen)
 		netif_wake_queue(dev->net);
 }
 
-static void lan78xx_bh(unsigned long param)
+static int lan78xx_bh(struct lan78xx_net *dev, int budget)
 {
-	struct lan78xx_net *dev = (struct lan78xx_net *)param;
 	struct sk_buff *skb;
 	struct skb_data *entry;
+	int work_done = 0;
 
-	while ((skb = skb_dequeue(&dev->done))) {
+	while (work_done < budget && (skb = skb_dequeue(&dev->done))) {
 		entry = (struct skb_data *)(skb->cb);
 		switch (entry->state) {
 		case rx_done:
 			entry->state = rx_cleanup;
 			rx_process(dev, skb);
+			work_done++;
 			continue;
 		case tx_done:
 			usb_free_urb(entry->urb);
@@ -3459,7 +3467,7 @@ static void lan78xx_bh(unsigned long param)
 			continue;
 		default:
 			netdev_dbg(dev->net, "skb state %d\n", entry->state);
-			return;
+			return work_done;
 		}
 	}
 
@@ -3478,6 +3486,23 @@ static void lan78xx_bh(unsigned long param)
 		    !test_bit(EVENT_RX_HALT, &dev->flags))
 			lan78xx_rx_bh(dev);
 	}
+
+	return work_done;
+}
+
+/* Each unit of work is one completed bulk-in URB, which may carry several
+ * frames. Tx completions and URB resubmission are not counted.
+ */
+static int lan78xx_poll(struct napi_struct *napi, int budget)
+{
+	struct lan78xx_net *dev = container_of(napi, struct lan78xx_net, napi);
+	int work_done;
+
+	work_done = lan78xx_bh(dev, budget);
+	if (work_done < budget)
+		napi_complete_done(napi, work_done);
+
+	return work_done;
 }
 
 static void lan78xx_delayedwork(struct work_struct *work)
@@ -3525,7 +3550,7 @@ static void lan78xx_delayedwork(struct work_struct *work)
 					   status);
 		} else {
 			clear_bit(EVENT_RX_HALT, &dev->flags);
-			tasklet_schedule(&dev->bh);
+			lan78xx_napi_schedule(dev);
 		}
 	}
 
@@ -3638,7 +3663,7 @@ static void lan78xx_tx_timeout(struct net_device *net, unsigned int txqueue)
 	struct lan78xx_net *dev = netdev_priv(net);
 
 	unlink_urbs(dev, &dev->txq);
-	tasklet_schedule(&dev->bh);
+	napi_schedule(&dev->napi);
 }
 
 static netdev_features_t lan78xx_features_check(struct sk_buff *skb,
@@ -3716,7 +3741,7 @@ static int lan78xx_probe(struct usb_interface *intf,
 	skb_queue_head_init(&dev->txq_pend);
 	mutex_init(&dev->phy_mutex);
 
-	tasklet_init(&dev->bh, lan78xx_bh, (unsigned long)dev);
+	netif_napi_add(netdev, &dev->napi, lan78xx_poll, NAPI_POLL_WEIGHT);
 	INIT_DELAYED_WORK(&dev->wq, lan78xx_delayedwork);
 	init_usb_anchor(&dev->deferred);
 
@@ -4132,7 +4157,7 @@ static int lan78xx_resume(struct usb_interface *intf)
 		if (test_bit(EVENT_DEV_OPEN, &dev->flags)) {
 			if (!(skb_queue_len(&dev->txq) >= dev->tx_qlen))
 				netif_start_queue(dev->net);
-			tasklet_schedule(&dev->bh);
+			lan78xx_napi_schedule(dev);
 		}
 	}
 
@@ -164,12 +164,12 @@ static int send6(struct wg_device *wg, struct sk_buff *skb,
 #endif
 }
 
-int wg_socket_send_skb_to_peer(struct wg_peer *peer, struct sk_buff *skb, u8 ds)
+/* Must be called with peer->endpoint_lock held for reading. */
+static int send_to_endpoint(struct wg_peer *peer, struct sk_buff *skb, u8 ds)
 {
 	size_t skb_len = skb->len;
 	int ret = -EAFNOSUPPORT;
 
-	read_lock_bh(&peer->endpoint_lock);
 	if (peer->endpoint.addr.sa_family == AF_INET)
 		ret = send4(peer->device, skb, &peer->endpoint, ds,
 			    &peer->endpoint_cache);
@@ -180,11 +180,43 @@ int wg_socket_send_skb_to_peer(struct wg_peer *peer, struct sk_buff *skb, u8 ds)
 		dev_kfree_skb(skb);
 	if (likely(!ret))
 		peer->tx_bytes += skb_len;
+
+	return ret;
+}
+
+int wg_socket_send_skb_to_peer(struct wg_peer *peer, struct sk_buff *skb, u8 ds)
+{
+	int ret;
+
+	read_lock_bh(&peer->endpoint_lock);
+	ret = send_to_endpoint(peer, skb, ds);
 	read_unlock_bh(&peer->endpoint_lock);
 
 	return ret;
 }
 
+/* Sends an encrypted bundle, such as the segments of a GSO super-packet, to
+ * the peer while taking the endpoint lock only once. Returns true if at least
+ * one of the packets sent was not a keepalive.
+ */
+bool wg_socket_send_skb_list_to_peer(struct wg_peer *peer,
+				     struct sk_buff *first)
+{
+	struct sk_buff *skb, *next;
+	bool is_keepalive, data_sent = false;
+
+	read_lock_bh(&peer->endpoint_lock);
+	skb_list_walk_safe(first, skb, next) {
+		is_keepalive = skb->len == message_data_len(0);
+		if (likely(!send_to_endpoint(peer, skb, PACKET_CB(skb)->ds) &&
+			   !is_keepalive))
+			data_sent = true;
+	}
+	read_unlock_bh(&peer->endpoint_lock);
+
+	return data_sent;
+}
+
 int wg_socket_send_buffer_to_peer(struct wg_peer *peer, void *buffer,
 				  size_t len, u8 ds)
 {
@@ -222,20 +222,32 @@ void brcmf_sdiod_change_state(struct brcmf_sdio_dev *sdiodev,
 static int brcmf_sdiod_set_backplane_window(struct brcmf_sdio_dev *sdiodev,
 					    u32 addr)
 {
-	u32 v, bar0 = addr & SBSDIO_SBWINDOW_MASK;
+	u32 mask, bar0 = addr & SBSDIO_SBWINDOW_MASK;
+	u32 cur = sdiodev->sbwad;
 	int err = 0, i;
 
-	if (bar0 == sdiodev->sbwad)
+	if (bar0 == cur)
 		return 0;
 
-	v = bar0 >> 8;
+	/*
+	 * Each window byte costs a CMD52, and consecutive accesses
+	 * usually differ only in the low byte(s), so skip the bytes
+	 * that already hold the right value.  Nothing can be skipped
+	 * while the hardware window is unknown.
+	 */
+	for (i = 0; i < 3; i++) {
+		mask = 0xff << (8 * (i + 1));
+		if (cur != U32_MAX && !((bar0 ^ cur) & mask))
+			continue;
 
-	for (i = 0 ; i < 3 && !err ; i++, v >>= 8)
 		brcmf_sdiod_writeb(sdiodev, SBSDIO_FUNC1_SBADDRLOW + i,
-				   v & 0xff, &err);
+				   (bar0 & mask) >> (8 * (i + 1)), &err);
+		if (err)
+			break;
+	}
 
-	if (!err)
-		sdiodev->sbwad = bar0;
+	/* a failed write leaves the hardware window unknown */
+	sdiodev->sbwad = err ? U32_MAX : bar0;
 
 	return err;
 }
@@ -885,7 +897,7 @@ int brcmf_sdiod_remove(struct brcmf_sdio_dev *sdiodev)
 	sdio_release_host(sdiodev->func1);
 
 	sg_free_table(&sdiodev->sgtable);
-	sdiodev->sbwad = 0;
+	sdiodev->sbwad = U32_MAX;
 
 	pm_runtime_allow(sdiodev->func1->card->host->parent);
 	return 0;
@@ -904,6 +916,9 @@ int brcmf_sdiod_probe(struct brcmf_sdio_dev *sdiodev)
 	int ret = 0;
 	unsigned int f2_blksz = SDIO_FUNC2_BLOCKSIZE;
 
+	/* the chip keeps its last backplane window across a reprobe */
+	sdiodev->sbwad = U32_MAX;
+
 	sdio_claim_host(sdiodev->func1);
 
 	ret = sdio_set_block_size(sdiodev->func1, SDIO_FUNC1_BLOCKSIZE);
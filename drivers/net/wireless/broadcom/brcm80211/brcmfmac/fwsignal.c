@@ -1437,6 +1437,8 @@ brcmf_fws_txs_process(struct brcmf_fws_info *fws, u8 flags, u32 hslot,
 		      u32 genbit, u16 seq, u8 compcnt)
 {
 	struct brcmf_pub *drvr = fws->drvr;
+	u8 credits[BRCMF_FWS_FIFO_COUNT] = {};
+	bool returned = false;
 	u32 fifo;
 	u8 cnt = 0;
 	int ret;
@@ -1489,14 +1491,15 @@ brcmf_fws_txs_process(struct brcmf_fws_info *fws, u8 flags, u32 hslot,
 		brcmf_dbg(DATA, "%s flags %d htod %X seq %X\n", entry->name,
 			  flags, skcb->htod, seq);
 
-		/* pick up the implicit credit from this packet */
+		/* pick up the implicit credit from this packet, the credits
+		 * are handed back in one go once the whole batch is done.
+		 */
 		fifo = brcmf_skb_htod_tag_get_field(skb, FIFO);
-		if (fws->fcmode == BRCMF_FWS_FCMODE_IMPLIED_CREDIT ||
-		    (brcmf_skb_if_flags_get_field(skb, REQ_CREDIT)) ||
-		    flags == BRCMF_FWS_TXSTATUS_HOST_TOSSED) {
-			brcmf_fws_return_credits(fws, fifo, 1);
-			brcmf_fws_schedule_deq(fws);
-		}
+		if ((fws->fcmode == BRCMF_FWS_FCMODE_IMPLIED_CREDIT ||
+		     (brcmf_skb_if_flags_get_field(skb, REQ_CREDIT)) ||
+		     flags == BRCMF_FWS_TXSTATUS_HOST_TOSSED) &&
+		    fifo < BRCMF_FWS_FIFO_COUNT)
+			credits[fifo]++;
 		brcmf_fws_macdesc_return_req_credit(skb);
 
 		ret = brcmf_proto_hdrpull(fws->drvr, false, skb, &ifp);
@@ -1519,6 +1522,15 @@ brcmf_fws_txs_process(struct brcmf_fws_info *fws, u8 flags, u32 hslot,
 		cnt++;
 	}
 
+	for (fifo = 0; fifo < BRCMF_FWS_FIFO_COUNT; fifo++) {
+		if (!credits[fifo])
+			continue;
+		brcmf_fws_return_credits(fws, fifo, credits[fifo]);
+		returned = true;
+	}
+	if (returned)
+		brcmf_fws_schedule_deq(fws);
+
 	return 0;
 }
 
@@ -422,6 +422,8 @@ struct brcmf_sdio_count {
 	uint rxglomfail;	/* Failed deglom attempts */
 	uint rxglomframes;	/* Number of glom frames (superframes) */
 	uint rxglompkts;	/* Number of packets from glom frames */
+	uint txglomframes;	/* Number of tx glom frames (superframes) */
+	uint txglompkts;	/* Number of packets sent in glom frames */
 	uint f2rxhdrs;		/* Number of header reads */
 	uint f2rxdata;		/* Number of frame data reads */
 	uint f2txdata;		/* Number of f2 frame writes */
@@ -2309,8 +2311,13 @@ static int brcmf_sdio_txpkt(struct brcmf_sdio *bus, struct sk_buff_head *pktq,
 
 done:
 	brcmf_sdio_txpkt_postp(bus, pktq);
-	if (ret == 0)
+	if (ret == 0) {
 		bus->tx_seq = (bus->tx_seq + pktq->qlen) % SDPCM_SEQ_WRAP;
+		if (pktq->qlen > 1) {
+			bus->sdcnt.txglomframes++;
+			bus->sdcnt.txglompkts += pktq->qlen;
+		}
+	}
 	skb_queue_walk_safe(pktq, pkt_next, tmp) {
 		__skb_unlink(pkt_next, pktq);
 		brcmf_proto_bcdc_txcomplete(bus->sdiodev->dev, pkt_next,
@@ -3178,6 +3185,7 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   "fc_rcvd:      %u\nfc_xoff:      %u\n"
 		   "fc_xon:       %u\nrxglomfail:   %u\n"
 		   "rxglomframes: %u\nrxglompkts:   %u\n"
+		   "txglomframes: %u\ntxglompkts:   %u\n"
 		   "f2rxhdrs:     %u\nf2rxdata:     %u\n"
 		   "f2txdata:     %u\nf1regdata:    %u\n"
 		   "tickcnt:      %u\ntx_ctlerrs:   %lu\n"
@@ -3192,6 +3200,7 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   sdcnt->fc_rcvd, sdcnt->fc_xoff,
 		   sdcnt->fc_xon, sdcnt->rxglomfail,
 		   sdcnt->rxglomframes, sdcnt->rxglompkts,
+		   sdcnt->txglomframes, sdcnt->txglompkts,
 		   sdcnt->f2rxhdrs, sdcnt->f2rxdata,
 		   sdcnt->f2txdata, sdcnt->f1regdata,
 		   sdcnt->tickcnt, sdcnt->tx_ctlerrs,
@@ -3201,6 +3210,50 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 	return 0;
 }
 
+static int brcmf_sdio_bound_get(void *data, u64 *val)
+{
+	*val = *(uint *)data;
+	return 0;
+}
+
+/* A bound of zero would stop the DPC from ever moving frames */
+static int brcmf_sdio_bound_set(void *data, u64 val)
+{
+	if (!val || val > UINT_MAX)
+		return -EINVAL;
+
+	*(uint *)data = val;
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(brcmf_sdio_bound_fops, brcmf_sdio_bound_get,
+			 brcmf_sdio_bound_set, "%llu\n");
+
+static int brcmf_sdio_txglomsz_get(void *data, u64 *val)
+{
+	struct brcmf_sdio_dev *sdiodev = data;
+
+	*val = sdiodev->txglomsz;
+	return 0;
+}
+
+/* The scatter-gather table is sized for the txglomsz module parameter at
+ * probe time, so the chain length may only be lowered from there.
+ */
+static int brcmf_sdio_txglomsz_set(void *data, u64 val)
+{
+	struct brcmf_sdio_dev *sdiodev = data;
+
+	if (!val || val > sdiodev->settings->bus.sdio.txglomsz)
+		return -EINVAL;
+
+	sdiodev->txglomsz = val;
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(brcmf_sdio_txglomsz_fops, brcmf_sdio_txglomsz_get,
+			 brcmf_sdio_txglomsz_set, "%llu\n");
+
 static void brcmf_sdio_debugfs_create(struct device *dev)
 {
 	struct brcmf_bus *bus_if = dev_get_drvdata(dev);
@@ -3219,6 +3272,12 @@ static void brcmf_sdio_debugfs_create(struct device *dev)
 				brcmf_debugfs_sdio_count_read);
 	debugfs_create_u32("console_interval", 0644, dentry,
 			   &bus->console_interval);
+	debugfs_create_file_unsafe("txbound", 0644, dentry, &bus->txbound,
+				   &brcmf_sdio_bound_fops);
+	debugfs_create_file_unsafe("rxbound", 0644, dentry, &bus->rxbound,
+				   &brcmf_sdio_bound_fops);
+	debugfs_create_file_unsafe("txglomsz", 0644, dentry, sdiodev,
+				   &brcmf_sdio_txglomsz_fops);
 }
 #else
 static int brcmf_sdio_checkdied(struct brcmf_sdio *bus)
@@ -344,6 +344,59 @@ static void bcm2835_gpio_set(struct gpio_chip *chip, unsigned offset, int value)
 	bcm2835_gpio_set_bit(pc, value ? GPSET0 : GPCLR0, offset);
 }
 
+/* 32 GPIOs per bank register, in the layout of the gpiolib bitmaps */
+static inline u32 bcm2835_gpio_bank_bits(const unsigned long *bits,
+					 unsigned int bank)
+{
+	unsigned int start = bank * 32;
+
+	return bits[BIT_WORD(start)] >> (start % BITS_PER_LONG);
+}
+
+static int bcm2835_gpio_get_multiple(struct gpio_chip *chip,
+				     unsigned long *mask, unsigned long *bits)
+{
+	struct bcm2835_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int bank, start, shift;
+	unsigned long bank_mask;
+	u32 val;
+
+	for (bank = 0; bank * 32 < chip->ngpio; bank++) {
+		bank_mask = bcm2835_gpio_bank_bits(mask, bank);
+		if (!bank_mask)
+			continue;
+
+		val = bcm2835_gpio_rd(pc, GPLEV0 + bank * 4);
+		start = bank * 32;
+		shift = start % BITS_PER_LONG;
+		bits[BIT_WORD(start)] &= ~(bank_mask << shift);
+		bits[BIT_WORD(start)] |= (val & bank_mask) << shift;
+	}
+
+	return 0;
+}
+
+static void bcm2835_gpio_set_multiple(struct gpio_chip *chip,
+				      unsigned long *mask, unsigned long *bits)
+{
+	struct bcm2835_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int bank;
+	u32 bank_mask, val;
+
+	/* one GPSET and one GPCLR write per bank, no read/modify/write */
+	for (bank = 0; bank * 32 < chip->ngpio; bank++) {
+		bank_mask = bcm2835_gpio_bank_bits(mask, bank);
+		if (!bank_mask)
+			continue;
+
+		val = bcm2835_gpio_bank_bits(bits, bank);
+		if (val & bank_mask)
+			bcm2835_gpio_wr(pc, GPSET0 + bank * 4, val & bank_mask);
+		if (~val & bank_mask)
+			bcm2835_gpio_wr(pc, GPCLR0 + bank * 4, ~val & bank_mask);
+	}
+}
+
 static int bcm2835_gpio_direction_output(struct gpio_chip *chip,
 		unsigned offset, int value)
 {
@@ -361,6 +414,8 @@ static const struct gpio_chip bcm2835_gpio_chip = {
 	.get_direction = bcm2835_gpio_get_direction,
 	.get = bcm2835_gpio_get,
 	.set = bcm2835_gpio_set,
+	.get_multiple = bcm2835_gpio_get_multiple,
+	.set_multiple = bcm2835_gpio_set_multiple,
 	.set_config = gpiochip_generic_config,
 	.base = 0,
 	.ngpio = BCM2835_NUM_GPIOS,
@@ -377,6 +432,8 @@ static const struct gpio_chip bcm2711_gpio_chip = {
 	.get_direction = bcm2835_gpio_get_direction,
 	.get = bcm2835_gpio_get,
 	.set = bcm2835_gpio_set,
+	.get_multiple = bcm2835_gpio_get_multiple,
+	.set_multiple = bcm2835_gpio_set_multiple,
 	.set_config = gpiochip_generic_config,
 	.base = 0,
 	.ngpio = BCM2711_NUM_GPIOS,
@@ -28,6 +28,7 @@ struct bcm2835_pwm {
 	struct device *dev;
 	void __iomem *base;
 	struct clk *clk;
+	unsigned long rate;
 };
 
 static inline struct bcm2835_pwm *to_bcm2835_pwm(struct pwm_chip *chip)
@@ -62,16 +63,22 @@ static int bcm2835_pwm_config(struct pwm_chip *chip, struct pwm_device *pwm,
 			      int duty_ns, int period_ns)
 {
 	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
-	unsigned long rate = clk_get_rate(pc->clk);
 	unsigned long scaler;
 	u32 period;
 
-	if (!rate) {
-		dev_err(pc->dev, "failed to get clock rate\n");
-		return -EINVAL;
+	/*
+	 * The rate is only locked while the channel is enabled, see
+	 * bcm2835_pwm_enable(), so re-read it when configuring a stopped one.
+	 */
+	if (!pwm_is_enabled(pwm)) {
+		unsigned long rate = clk_get_rate(pc->clk);
+
+		if (!rate)
+			return -EINVAL;
+		pc->rate = rate;
 	}
 
-	scaler = DIV_ROUND_CLOSEST(NSEC_PER_SEC, rate);
+	scaler = DIV_ROUND_CLOSEST(NSEC_PER_SEC, pc->rate);
 	period = DIV_ROUND_CLOSEST(period_ns, scaler);
 
 	if (period < PERIOD_MIN)
@@ -87,7 +94,30 @@ static int bcm2835_pwm_config(struct pwm_chip *chip, struct pwm_device *pwm,
 static int bcm2835_pwm_enable(struct pwm_chip *chip, struct pwm_device *pwm)
 {
 	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
+	unsigned long rate;
 	u32 value;
+	int ret;
+
+	/*
+	 * Keep the clock rate fixed while the channel is running, so that
+	 * period updates can use the cached rate and the output doesn't
+	 * drift if somebody else reprograms the parent.
+	 */
+	ret = clk_rate_exclusive_get(pc->clk);
+	if (ret)
+		return ret;
+
+	/* The rate may have moved since the period was programmed */
+	rate = clk_get_rate(pc->clk);
+	if (rate != pc->rate) {
+		pc->rate = rate;
+		ret = bcm2835_pwm_config(chip, pwm, pwm->state.duty_cycle,
+					 pwm->state.period);
+		if (ret) {
+			clk_rate_exclusive_put(pc->clk);
+			return ret;
+		}
+	}
 
 	value = readl(pc->base + PWM_CONTROL);
 	value |= PWM_ENABLE << PWM_CONTROL_SHIFT(pwm->hwpwm);
@@ -104,6 +134,8 @@ static void bcm2835_pwm_disable(struct pwm_chip *chip, struct pwm_device *pwm)
 	value = readl(pc->base + PWM_CONTROL);
 	value &= ~(PWM_ENABLE << PWM_CONTROL_SHIFT(pwm->hwpwm));
 	writel(value, pc->base + PWM_CONTROL);
+
+	clk_rate_exclusive_put(pc->clk);
 }
 
 static int bcm2835_set_polarity(struct pwm_chip *chip, struct pwm_device *pwm,
@@ -160,6 +192,13 @@ static int bcm2835_pwm_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
+	pc->rate = clk_get_rate(pc->clk);
+	if (!pc->rate) {
+		dev_err(pc->dev, "failed to get clock rate\n");
+		ret = -EINVAL;
+		goto add_fail;
+	}
+
 	pc->chip.dev = &pdev->dev;
 	pc->chip.ops = &bcm2835_pwm_ops;
 	pc->chip.base = -1;
@@ -84,6 +84,10 @@ MODULE_PARM_DESC(polling_limit_us,
  * struct bcm2835_spi - BCM2835 SPI controller
  * @regs: base address of register map
  * @clk: core clock, divided to calculate serial clock
+ * @clk_hz: core clock speed, sampled once per message by ->prepare_message()
+ * @speed_hz: serial clock speed last requested by a transfer
+ * @cdiv: clock divider calculated for @speed_hz
+ * @cdiv_clk_hz: core clock speed @cdiv was calculated from
  * @irq: interrupt, signals TX FIFO empty or RX FIFO ¾ full
  * @tfr: SPI transfer currently processed
  * @ctlr: SPI controller reverse lookup
@@ -124,6 +128,10 @@ MODULE_PARM_DESC(polling_limit_us,
 struct bcm2835_spi {
 	void __iomem *regs;
 	struct clk *clk;
+	unsigned long clk_hz;
+	unsigned long speed_hz;
+	unsigned long cdiv;
+	unsigned long cdiv_clk_hz;
 	int irq;
 	struct spi_transfer *tfr;
 	struct spi_controller *ctlr;
@@ -1100,11 +1108,16 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 		return 0;
 	}
 
-	/* set clock */
+	/*
+	 * Set clock.  Messages made of many small transfers normally run at
+	 * one speed, so only recalculate the divider when the speed changes.
+	 */
 	spi_hz = tfr->speed_hz;
-	clk_hz = clk_get_rate(bs->clk);
+	clk_hz = bs->clk_hz;
 
-	if (spi_hz >= clk_hz / 2) {
+	if (spi_hz == bs->speed_hz && clk_hz == bs->cdiv_clk_hz) {
+		cdiv = bs->cdiv;
+	} else if (spi_hz >= clk_hz / 2) {
 		cdiv = 2; /* clk_hz/2 is the fastest we can go */
 	} else if (spi_hz) {
 		/* CDIV must be a multiple of two */
@@ -1116,6 +1129,9 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 	} else {
 		cdiv = 0; /* 0 is the slowest we can go */
 	}
+	bs->speed_hz = spi_hz;
+	bs->cdiv = cdiv;
+	bs->cdiv_clk_hz = clk_hz;
 	tfr->effective_speed_hz = cdiv ? (clk_hz / cdiv) : (clk_hz / 65536);
 	bcm2835_wr(bs, BCM2835_SPI_CLK, cdiv);
 
@@ -1153,6 +1169,28 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 	return bcm2835_spi_transfer_one_irq(ctlr, spi, tfr, cs, true);
 }
 
+static int bcm2835_spi_split_message(struct spi_controller *ctlr,
+				     struct spi_message *msg)
+{
+	if (!ctlr->can_dma)
+		return 0;
+
+	/*
+	 * DMA transfers are limited to 16 bit (0 to 65535 bytes) by
+	 * the SPI HW due to DLEN. Split up transfers (32-bit FIFO
+	 * aligned) if the limit is exceeded.
+	 */
+	return spi_split_transfers_maxsize(ctlr, msg, 65532,
+					   GFP_KERNEL | GFP_DMA);
+}
+
+static int bcm2835_spi_optimize_message(struct spi_controller *ctlr,
+					struct spi_message *msg)
+{
+	/* the split transfers are kept until the message is unoptimized */
+	return bcm2835_spi_split_message(ctlr, msg);
+}
+
 static int bcm2835_spi_prepare_message(struct spi_controller *ctlr,
 				       struct spi_message *msg)
 {
@@ -1160,18 +1198,19 @@ static int bcm2835_spi_prepare_message(struct spi_controller *ctlr,
 	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
 	int ret;
 
-	if (ctlr->can_dma) {
-		/*
-		 * DMA transfers are limited to 16 bit (0 to 65535 bytes) by
-		 * the SPI HW due to DLEN. Split up transfers (32-bit FIFO
-		 * aligned) if the limit is exceeded.
-		 */
-		ret = spi_split_transfers_maxsize(ctlr, msg, 65532,
-						  GFP_KERNEL | GFP_DMA);
+	if (!msg->pre_optimized) {
+		ret = bcm2835_spi_split_message(ctlr, msg);
 		if (ret)
 			return ret;
 	}
 
+	/*
+	 * The firmware may rescale the core clock behind the clock framework's
+	 * back (the clock is CLK_GET_RATE_NOCACHE and no rate-change notifier
+	 * fires), so sample its rate once per message rather than per transfer.
+	 */
+	bs->clk_hz = clk_get_rate(bs->clk);
+
 	/*
 	 * Set up clock polarity before spi_transfer_one_message() asserts
 	 * chip select to avoid a gratuitous clock signal edge.
@@ -1307,6 +1346,7 @@ static int bcm2835_spi_probe(struct platform_device *pdev)
 	ctlr->transfer_one = bcm2835_spi_transfer_one;
 	ctlr->handle_err = bcm2835_spi_handle_err;
 	ctlr->prepare_message = bcm2835_spi_prepare_message;
+	ctlr->optimize_message = bcm2835_spi_optimize_message;
 	ctlr->dev.of_node = pdev->dev.of_node;
 
 	bs = spi_controller_get_devdata(ctlr);
@@ -1729,9 +1729,11 @@ void spi_finalize_current_message(struct spi_controller *ctlr)
 	/* In the prepare_messages callback the spi bus has the opportunity to
 	 * split a transfer to smaller chunks.
 	 * Release splited transfers here since spi_map_msg is done on the
-	 * splited transfers.
+	 * splited transfers. Pre-optimized messages keep theirs until
+	 * spi_unoptimize_message().
 	 */
-	spi_res_release(ctlr, mesg);
+	if (!mesg->pre_optimized)
+		spi_res_release(ctlr, mesg);
 
 	if (ctlr->cur_msg_prepared && ctlr->unprepare_message) {
 		ret = ctlr->unprepare_message(ctlr, mesg);
@@ -3648,6 +3650,93 @@ static int __spi_validate(struct spi_device *spi, struct spi_message *message)
 	return 0;
 }
 
+/*
+ * Messages that went through spi_optimize_message() were validated then and,
+ * as long as their transfers are not modified, need not be validated again.
+ */
+static int spi_maybe_validate(struct spi_device *spi,
+			      struct spi_message *message)
+{
+	if (message->pre_optimized) {
+		if (WARN_ON_ONCE(message->spi != spi))
+			return -EINVAL;
+
+		message->status = -EINPROGRESS;
+		return 0;
+	}
+
+	return __spi_validate(spi, message);
+}
+
+/**
+ * spi_optimize_message - validate and prepare a message for repeated use
+ * @spi: device the message will be sent to
+ * @msg: the message to optimize
+ * Context: can sleep
+ *
+ * Do the validation (and any controller specific preparation) of @msg once,
+ * so that it can then be submitted any number of times with spi_sync() or
+ * spi_async() at lower cost.  The message, its transfers and their buffers
+ * (though not the buffer contents) must not be changed until
+ * spi_unoptimize_message() is called.
+ *
+ * Return: zero on success, else a negative error code.
+ */
+int spi_optimize_message(struct spi_device *spi, struct spi_message *msg)
+{
+	struct spi_controller *ctlr = spi->controller;
+	int ret;
+
+	if (msg->pre_optimized)
+		return -EBUSY;
+
+	ret = __spi_validate(spi, msg);
+	if (ret)
+		goto err_release;
+
+	msg->spi = spi;
+
+	if (ctlr->optimize_message) {
+		ret = ctlr->optimize_message(ctlr, msg);
+		if (ret)
+			goto err_release;
+	}
+
+	msg->pre_optimized = true;
+
+	return 0;
+
+err_release:
+	/* __spi_validate() may already have split transfers */
+	spi_res_release(ctlr, msg);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(spi_optimize_message);
+
+/**
+ * spi_unoptimize_message - release the state set up by spi_optimize_message()
+ * @msg: the message, which must not be in flight
+ * Context: can sleep
+ *
+ * After this call the message may be modified or freed again.
+ */
+void spi_unoptimize_message(struct spi_message *msg)
+{
+	struct spi_controller *ctlr;
+
+	if (!msg->pre_optimized)
+		return;
+
+	ctlr = msg->spi->controller;
+	if (ctlr->unoptimize_message)
+		ctlr->unoptimize_message(ctlr, msg);
+
+	spi_res_release(ctlr, msg);
+	msg->opt_state = NULL;
+	msg->pre_optimized = false;
+}
+EXPORT_SYMBOL_GPL(spi_unoptimize_message);
+
 static int __spi_async(struct spi_device *spi, struct spi_message *message)
 {
 	struct spi_controller *ctlr = spi->controller;
@@ -3714,7 +3803,7 @@ int spi_async(struct spi_device *spi, struct spi_message *message)
 	int ret;
 	unsigned long flags;
 
-	ret = __spi_validate(spi, message);
+	ret = spi_maybe_validate(spi, message);
 	if (ret != 0)
 		return ret;
 
@@ -3768,7 +3857,7 @@ int spi_async_locked(struct spi_device *spi, struct spi_message *message)
 	int ret;
 	unsigned long flags;
 
-	ret = __spi_validate(spi, message);
+	ret = spi_maybe_validate(spi, message);
 	if (ret != 0)
 		return ret;
 
@@ -3802,7 +3891,7 @@ static int __spi_sync(struct spi_device *spi, struct spi_message *message)
 	struct spi_controller *ctlr = spi->controller;
 	unsigned long flags;
 
-	status = __spi_validate(spi, message);
+	status = spi_maybe_validate(spi, message);
 	if (status != 0)
 		return status;
 
@@ -6,13 +6,18 @@
 #include <linux/errno.h>
 #include <linux/interrupt.h>
 #include <linux/pagemap.h>
+#include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmapool.h>
 #include <linux/io.h>
 #include <linux/platform_device.h>
 #include <linux/uaccess.h>
 #include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/of.h>
+#include <linux/sbitmap.h>
+#include <linux/sched/signal.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <soc/bcm2835/raspberrypi-firmware.h>
 
@@ -23,6 +28,8 @@
 #include "vchiq_pagelist.h"
 
 #define MAX_FRAGMENTS (VCHIQ_NUM_CURRENT_BULKS * 2)
+/* The fragment index is carried in the u16 pagelist type field. */
+#define MAX_FRAGMENTS_LIMIT (U16_MAX - PAGELIST_READ_WITH_FRAGMENTS)
 
 #define VCHIQ_PLATFORM_FRAGMENTS_OFFSET_IDX 0
 #define VCHIQ_PLATFORM_FRAGMENTS_COUNT_IDX  1
@@ -45,9 +52,11 @@ struct vchiq_pagelist_info {
 	enum dma_data_direction dma_dir;
 	unsigned int num_pages;
 	unsigned int pages_need_release;
+	unsigned int fragments_cpu;
 	struct page **pages;
 	struct scatterlist *scatterlist;
 	unsigned int scatterlist_mapped;
+	struct vchiq_dmabuf_import *import;
 };
 
 static void __iomem *g_regs;
@@ -66,12 +75,20 @@ static struct dma_pool *g_dma_pool;
 static unsigned int g_use_36bit_addrs = 0;
 static unsigned int g_fragments_size;
 static char *g_fragments_base;
-static char *g_free_fragments;
-static struct semaphore g_free_fragments_sema;
+static struct sbitmap_queue g_free_fragments;
+static atomic_t g_fragments_wait_index = ATOMIC_INIT(0);
+static atomic_long_t g_fragments_waits = ATOMIC_LONG_INIT(0);
 static struct device *g_dev;
 static struct device *g_dma_dev;
 
-static DEFINE_SEMAPHORE(g_free_fragments_mutex);
+/*
+ * Number of fragment buffers for partial cache lines at the ends of bulk
+ * reads. Zero means use the DT "brcm,fragments" property, or
+ * MAX_FRAGMENTS if that is absent too.
+ */
+static unsigned int fragments_param;
+module_param_named(fragments, fragments_param, uint, 0444);
+MODULE_PARM_DESC(fragments, "Number of bulk fragment buffers (0 = default)");
 
 static irqreturn_t
 vchiq_doorbell_irq(int irq, void *dev_id);
@@ -79,10 +96,19 @@ vchiq_doorbell_irq(int irq, void *dev_id);
 static struct vchiq_pagelist_info *
 create_pagelist(char *buf, char __user *ubuf, size_t count, unsigned short type);
 
+static struct vchiq_pagelist_info *
+create_pagelist_dmabuf(const struct vchiq_bulk_dmabuf *dmabuf,
+		       size_t count, unsigned short type);
+
 static void
 free_pagelist(struct vchiq_pagelist_info *pagelistinfo,
 	      int actual);
 
+static void vchiq_free_fragments(void *data)
+{
+	sbitmap_queue_free(&g_free_fragments);
+}
+
 int vchiq_platform_init(struct platform_device *pdev, struct vchiq_state *state)
 {
 	struct device *dev = &pdev->dev;
@@ -94,7 +120,8 @@ int vchiq_platform_init(struct platform_device *pdev, struct vchiq_state *state)
 	dma_addr_t slot_phys;
 	u32 channelbase;
 	int slot_mem_size, frag_mem_size;
-	int err, irq, i;
+	u32 num_fragments = MAX_FRAGMENTS;
+	int err, irq;
 
 	/*
 	 * VCHI messages between the CPU and firmware use
@@ -126,9 +153,28 @@ int vchiq_platform_init(struct platform_device *pdev, struct vchiq_state *state)
 		}
 	}
 
+	of_property_read_u32(dev->of_node, "brcm,fragments", &num_fragments);
+	if (fragments_param)
+		num_fragments = fragments_param;
+	num_fragments = clamp_t(u32, num_fragments, 1, MAX_FRAGMENTS_LIMIT);
+
+	/*
+	 * The free fragments are tracked with a per-CPU hinted bitmap rather
+	 * than a locked free list, so concurrent bulk transfers don't
+	 * serialise on create_pagelist()/free_pagelist().
+	 */
+	err = sbitmap_queue_init_node(&g_free_fragments, num_fragments, -1,
+				      false, GFP_KERNEL, dev_to_node(dev));
+	if (err)
+		return err;
+
+	err = devm_add_action_or_reset(dev, vchiq_free_fragments, NULL);
+	if (err)
+		return err;
+
 	/* Allocate space for the channels in coherent memory */
 	slot_mem_size = PAGE_ALIGN(TOTAL_SLOTS * VCHIQ_SLOT_SIZE);
-	frag_mem_size = PAGE_ALIGN(g_fragments_size * MAX_FRAGMENTS);
+	frag_mem_size = PAGE_ALIGN(g_fragments_size * num_fragments);
 
 	slot_mem = dmam_alloc_coherent(dev, slot_mem_size + frag_mem_size,
 				       &slot_phys, GFP_KERNEL);
@@ -147,18 +193,10 @@ int vchiq_platform_init(struct platform_device *pdev, struct vchiq_state *state)
 	vchiq_slot_zero->platform_data[VCHIQ_PLATFORM_FRAGMENTS_OFFSET_IDX] =
 		channelbase + slot_mem_size;
 	vchiq_slot_zero->platform_data[VCHIQ_PLATFORM_FRAGMENTS_COUNT_IDX] =
-		MAX_FRAGMENTS;
+		num_fragments;
 
 	g_fragments_base = (char *)slot_mem + slot_mem_size;
 
-	g_free_fragments = g_fragments_base;
-	for (i = 0; i < (MAX_FRAGMENTS - 1); i++) {
-		*(char **)&g_fragments_base[i*g_fragments_size] =
-			&g_fragments_base[(i + 1)*g_fragments_size];
-	}
-	*(char **)&g_fragments_base[i * g_fragments_size] = NULL;
-	sema_init(&g_free_fragments_sema, MAX_FRAGMENTS);
-
 	if (vchiq_init_state(state, vchiq_slot_zero) != VCHIQ_SUCCESS)
 		return -EINVAL;
 
@@ -252,14 +290,18 @@ remote_event_signal(struct remote_event *event)
 
 enum vchiq_status
 vchiq_prepare_bulk_data(struct vchiq_bulk *bulk, void *offset,
-			void __user *uoffset, int size, int dir)
+			void __user *uoffset,
+			const struct vchiq_bulk_dmabuf *dmabuf,
+			int size, int dir)
 {
 	struct vchiq_pagelist_info *pagelistinfo;
+	unsigned short type = (dir == VCHIQ_BULK_RECEIVE) ?
+			      PAGELIST_READ : PAGELIST_WRITE;
 
-	pagelistinfo = create_pagelist(offset, uoffset, size,
-				       (dir == VCHIQ_BULK_RECEIVE)
-				       ? PAGELIST_READ
-				       : PAGELIST_WRITE);
+	if (dmabuf)
+		pagelistinfo = create_pagelist_dmabuf(dmabuf, size, type);
+	else
+		pagelistinfo = create_pagelist(offset, uoffset, size, type);
 
 	if (!pagelistinfo)
 		return VCHIQ_ERROR;
@@ -283,6 +325,71 @@ vchiq_complete_bulk(struct vchiq_bulk *bulk)
 			      bulk->actual);
 }
 
+void vchiq_platform_fragments_show(struct seq_file *f)
+{
+	seq_printf(f, "fragment_size=%u\n", g_fragments_size);
+	seq_printf(f, "waits=%ld\n", atomic_long_read(&g_fragments_waits));
+	sbitmap_queue_show(&g_free_fragments, f);
+}
+
+/*
+ * Attaches to and maps @dmabuf for the VPU. The import takes over the
+ * caller's reference on @dmabuf, and keeps the mapping until the last
+ * reference is dropped with vchiq_platform_dmabuf_put().
+ */
+struct vchiq_dmabuf_import *
+vchiq_platform_dmabuf_import(struct dma_buf *dmabuf)
+{
+	struct vchiq_dmabuf_import *import;
+	int ret;
+
+	import = kzalloc(sizeof(*import), GFP_KERNEL);
+	if (!import)
+		return ERR_PTR(-ENOMEM);
+
+	import->attach = dma_buf_attach(dmabuf, g_dma_dev);
+	if (IS_ERR(import->attach)) {
+		ret = PTR_ERR(import->attach);
+		goto err_free;
+	}
+
+	import->sgt = dma_buf_map_attachment(import->attach,
+					     DMA_BIDIRECTIONAL);
+	if (IS_ERR(import->sgt)) {
+		ret = PTR_ERR(import->sgt);
+		goto err_detach;
+	}
+
+	kref_init(&import->kref);
+	INIT_LIST_HEAD(&import->list);
+	import->dmabuf = dmabuf;
+
+	return import;
+
+err_detach:
+	dma_buf_detach(dmabuf, import->attach);
+err_free:
+	kfree(import);
+	return ERR_PTR(ret);
+}
+
+static void vchiq_dmabuf_import_release(struct kref *kref)
+{
+	struct vchiq_dmabuf_import *import =
+		container_of(kref, struct vchiq_dmabuf_import, kref);
+
+	dma_buf_unmap_attachment(import->attach, import->sgt,
+				 DMA_BIDIRECTIONAL);
+	dma_buf_detach(import->dmabuf, import->attach);
+	dma_buf_put(import->dmabuf);
+	kfree(import);
+}
+
+void vchiq_platform_dmabuf_put(struct vchiq_dmabuf_import *import)
+{
+	kref_put(&import->kref, vchiq_dmabuf_import_release);
+}
+
 int vchiq_dump_platform_state(void *dump_context)
 {
 	char buf[80];
@@ -326,6 +433,9 @@ cleanup_pagelistinfo(struct vchiq_pagelist_info *pagelistinfo)
 	if (pagelistinfo->pages_need_release)
 		unpin_user_pages(pagelistinfo->pages, pagelistinfo->num_pages);
 
+	if (pagelistinfo->import)
+		vchiq_platform_dmabuf_put(pagelistinfo->import);
+
 	if (pagelistinfo->is_from_pool) {
 		dma_pool_free(g_dma_pool, pagelistinfo->pagelist,
 			      pagelistinfo->dma_addr);
@@ -336,6 +446,83 @@ cleanup_pagelistinfo(struct vchiq_pagelist_info *pagelistinfo)
 	}
 }
 
+/*
+ * Appends the DMA block at @addr to the first @k entries of @addrs, merging
+ * it with the previous entry where the blocks are contiguous. Returns the
+ * new number of entries.
+ */
+static unsigned int
+add_pagelist_block(u32 *addrs, unsigned int k, dma_addr_t addr, u32 len)
+{
+	u32 block_pages = DIV_ROUND_UP((addr & ~PAGE_MASK) + len, PAGE_SIZE);
+
+	if (g_use_36bit_addrs) {
+		u32 page_id = (u32)((addr >> 4) & ~0xff);
+
+		/* Note: addrs is the address + page_count - 1 */
+		WARN_ON(upper_32_bits(addr) > 0xf);
+		if (k > 0 &&
+		    ((addrs[k - 1] & ~0xff) +
+		     (((addrs[k - 1] & 0xff) + 1) << 8)
+		     == page_id)) {
+			u32 inc_pages = min(block_pages,
+					    0xff - (addrs[k - 1] & 0xff));
+			addrs[k - 1] += inc_pages;
+			page_id += inc_pages << 8;
+			block_pages -= inc_pages;
+		}
+		while (block_pages) {
+			u32 inc_pages = min(block_pages, 0x100u);
+			addrs[k++] = page_id | (inc_pages - 1);
+			page_id += inc_pages << 8;
+			block_pages -= inc_pages;
+		}
+	} else {
+		u32 addr32 = addr;
+
+		/* Note: addrs is the address + page_count - 1 */
+		if (k > 0 &&
+		    ((addrs[k - 1] & PAGE_MASK) +
+		     (((addrs[k - 1] & ~PAGE_MASK) + 1) << PAGE_SHIFT))
+		    == (addr32 & PAGE_MASK))
+			addrs[k - 1] += block_pages;
+		else
+			addrs[k++] = (addr32 & PAGE_MASK) | (block_pages - 1);
+	}
+
+	return k;
+}
+
+/*
+ * Allocates a fragment buffer, sleeping interruptibly if none is free.
+ * Returns the fragment index, or -1 if interrupted by a signal.
+ */
+static int
+vchiq_get_fragments(unsigned int *cpu)
+{
+	struct sbq_wait_state *ws;
+	DEFINE_SBQ_WAIT(wait);
+	int nr;
+
+	nr = sbitmap_queue_get(&g_free_fragments, cpu);
+	if (nr >= 0)
+		return nr;
+
+	atomic_long_inc(&g_fragments_waits);
+	ws = sbq_wait_ptr(&g_free_fragments, &g_fragments_wait_index);
+	for (;;) {
+		sbitmap_prepare_to_wait(&g_free_fragments, ws, &wait,
+					TASK_INTERRUPTIBLE);
+		nr = sbitmap_queue_get(&g_free_fragments, cpu);
+		if (nr >= 0 || signal_pending(current))
+			break;
+		schedule();
+	}
+	sbitmap_finish_wait(&g_free_fragments, ws, &wait);
+
+	return nr;
+}
+
 /* There is a potential problem with partial cache lines (pages?)
  * at the ends of the block when reading. If the CPU accessed anything in
  * the same line (page?) then it may have pulled old data into the cache,
@@ -498,60 +685,17 @@ create_pagelist(char *buf, char __user *ubuf,
 
 	/* Combine adjacent blocks for performance */
 	k = 0;
-	if (g_use_36bit_addrs) {
-		for_each_sg(scatterlist, sg, dma_buffers, i) {
-			u32 len = sg_dma_len(sg);
-			u64 addr = sg_dma_address(sg);
-			u32 page_id = (u32)((addr >> 4) & ~0xff);
-			u32 sg_pages = (len + PAGE_SIZE - 1) >> PAGE_SHIFT;
-
-			/* Note: addrs is the address + page_count - 1
-			 * The firmware expects blocks after the first to be page-
-			 * aligned and a multiple of the page size
-			 */
-			WARN_ON(len == 0);
-			WARN_ON(i &&
-				(i != (dma_buffers - 1)) && (len & ~PAGE_MASK));
-			WARN_ON(i && (addr & ~PAGE_MASK));
-			WARN_ON(upper_32_bits(addr) > 0xf);
-			if (k > 0 &&
-			    ((addrs[k - 1] & ~0xff) +
-			     (((addrs[k - 1] & 0xff) + 1) << 8)
-			     == page_id)) {
-				u32 inc_pages = min(sg_pages,
-						    0xff - (addrs[k - 1] & 0xff));
-				addrs[k - 1] += inc_pages;
-				page_id += inc_pages << 8;
-				sg_pages -= inc_pages;
-			}
-			while (sg_pages) {
-				u32 inc_pages = min(sg_pages, 0x100u);
-				addrs[k++] = page_id | (inc_pages - 1);
-				page_id += inc_pages << 8;
-				sg_pages -= inc_pages;
-			}
-		}
-	} else {
-		for_each_sg(scatterlist, sg, dma_buffers, i) {
-			u32 len = sg_dma_len(sg);
-			u32 addr = sg_dma_address(sg);
-			u32 new_pages = (len + PAGE_SIZE - 1) >> PAGE_SHIFT;
-
-			/* Note: addrs is the address + page_count - 1
-			 * The firmware expects blocks after the first to be page-
-			 * aligned and a multiple of the page size
-			 */
-			WARN_ON(len == 0);
-			WARN_ON(i && (i != (dma_buffers - 1)) && (len & ~PAGE_MASK));
-			WARN_ON(i && (addr & ~PAGE_MASK));
-			if (k > 0 &&
-			    ((addrs[k - 1] & PAGE_MASK) +
-			     (((addrs[k - 1] & ~PAGE_MASK) + 1) << PAGE_SHIFT))
-			    == (addr & PAGE_MASK))
-				addrs[k - 1] += new_pages;
-			else
-				addrs[k++] = (addr & PAGE_MASK) | (new_pages - 1);
-		}
+	for_each_sg(scatterlist, sg, dma_buffers, i) {
+		u32 len = sg_dma_len(sg);
+		dma_addr_t addr = sg_dma_address(sg);
+
+		/* The firmware expects blocks after the first to be page-
+		 * aligned and a multiple of the page size
+		 */
+		WARN_ON(len == 0);
+		WARN_ON(i && (i != (dma_buffers - 1)) && (len & ~PAGE_MASK));
+		WARN_ON(i && (addr & ~PAGE_MASK));
+		k = add_pagelist_block(addrs, k, addr, len);
 	}
 
 	/* Partial cache lines (fragments) require special measures */
@@ -559,25 +703,129 @@ create_pagelist(char *buf, char __user *ubuf,
 		((pagelist->offset & (g_cache_line_size - 1)) ||
 		((pagelist->offset + pagelist->length) &
 		(g_cache_line_size - 1)))) {
-		char *fragments;
+		int nr = vchiq_get_fragments(&pagelistinfo->fragments_cpu);
 
-		if (down_interruptible(&g_free_fragments_sema)) {
+		if (nr < 0) {
 			cleanup_pagelistinfo(pagelistinfo);
 			return NULL;
 		}
 
-		WARN_ON(!g_free_fragments);
+		pagelist->type = PAGELIST_READ_WITH_FRAGMENTS + nr;
+	}
+
+	return pagelistinfo;
+}
+
+/*
+ * Builds a pagelist for a range of an imported dma-buf straight from its
+ * cached DMA mapping, so there are no pages to pin, map or sync. The
+ * exporter's CPU access hooks take care of coherency, which also means
+ * receive ranges must be cache line aligned as there is no fragment
+ * handling.
+ */
+static struct vchiq_pagelist_info *
+create_pagelist_dmabuf(const struct vchiq_bulk_dmabuf *dmabuf,
+		       size_t count, unsigned short type)
+{
+	struct vchiq_dmabuf_import *import = dmabuf->import;
+	struct vchiq_pagelist_info *pagelistinfo;
+	struct pagelist *pagelist;
+	size_t skip = dmabuf->offset;
+	size_t pagelist_size;
+	struct scatterlist *sg;
+	dma_addr_t dma_addr;
+	unsigned int num_pages, i, k;
+	bool is_from_pool;
+	size_t remaining;
+	u32 *addrs;
+
+	if (!count || count > import->dmabuf->size ||
+	    skip > import->dmabuf->size - count)
+		return NULL;
+
+	if ((type == PAGELIST_READ) &&
+	    ((skip | count) & (g_cache_line_size - 1)))
+		return NULL;
+
+	/*
+	 * Every block after the first is page aligned, so the range can
+	 * touch at most one more page than its length alone would need.
+	 */
+	num_pages = DIV_ROUND_UP(count, PAGE_SIZE) + 1;
+
+	pagelist_size = sizeof(struct pagelist) +
+			(num_pages * sizeof(u32)) +
+			sizeof(struct vchiq_pagelist_info);
+
+	if (pagelist_size > VCHIQ_DMA_POOL_SIZE) {
+		pagelist = dma_alloc_coherent(g_dev, pagelist_size,
+					      &dma_addr, GFP_KERNEL);
+		is_from_pool = false;
+	} else {
+		pagelist = dma_pool_alloc(g_dma_pool, GFP_KERNEL, &dma_addr);
+		is_from_pool = true;
+	}
+
+	if (!pagelist)
+		return NULL;
+
+	addrs = pagelist->addrs;
+	pagelistinfo = (struct vchiq_pagelist_info *)(addrs + num_pages);
+	memset(pagelistinfo, 0, sizeof(*pagelistinfo));
+
+	pagelist->length = count;
+	pagelist->type = type;
+
+	pagelistinfo->pagelist = pagelist;
+	pagelistinfo->pagelist_buffer_size = pagelist_size;
+	pagelistinfo->dma_addr = dma_addr;
+	pagelistinfo->is_from_pool = is_from_pool;
 
-		down(&g_free_fragments_mutex);
-		fragments = g_free_fragments;
-		WARN_ON(!fragments);
-		g_free_fragments = *(char **) g_free_fragments;
-		up(&g_free_fragments_mutex);
-		pagelist->type = PAGELIST_READ_WITH_FRAGMENTS +
-			(fragments - g_fragments_base) / g_fragments_size;
+	k = 0;
+	remaining = count;
+	for_each_sgtable_dma_sg(import->sgt, sg, i) {
+		dma_addr_t addr = sg_dma_address(sg);
+		size_t len = sg_dma_len(sg);
+
+		if (skip >= len) {
+			skip -= len;
+			continue;
+		}
+
+		addr += skip;
+		len = min(len - skip, remaining);
+
+		/* The firmware expects blocks after the first to be page-
+		 * aligned, and all but the last a multiple of the page size
+		 */
+		if (k == 0)
+			pagelist->offset = addr & ~PAGE_MASK;
+		else if (addr & ~PAGE_MASK)
+			goto err;
+		remaining -= len;
+		if (remaining && ((addr + len) & ~PAGE_MASK))
+			goto err;
+
+		k = add_pagelist_block(addrs, k, addr, len);
+		skip = 0;
+		if (!remaining)
+			break;
 	}
 
+	if (remaining)
+		goto err;
+
+	kref_get(&import->kref);
+	pagelistinfo->import = import;
+
 	return pagelistinfo;
+
+err:
+	vchiq_log_error(vchiq_arm_log_level,
+			"%s - dma-buf layout unsuitable for a pagelist",
+			__func__);
+	cleanup_pagelistinfo(pagelistinfo);
+	return NULL;
 }
 
 static void
@@ -595,15 +843,15 @@ free_pagelist(struct vchiq_pagelist_info *pagelistinfo,
 	 * NOTE: dma_unmap_sg must be called before the
 	 * cpu can touch any of the data/pages.
 	 */
-	dma_unmap_sg(g_dma_dev, pagelistinfo->scatterlist,
-		     pagelistinfo->num_pages, pagelistinfo->dma_dir);
+	if (pagelistinfo->scatterlist_mapped)
+		dma_unmap_sg(g_dma_dev, pagelistinfo->scatterlist,
+			     pagelistinfo->num_pages, pagelistinfo->dma_dir);
 	pagelistinfo->scatterlist_mapped = 0;
 
 	/* Deal with any partial cache lines (fragments) */
 	if (pagelist->type >= PAGELIST_READ_WITH_FRAGMENTS) {
-		char *fragments = g_fragments_base +
-			(pagelist->type - PAGELIST_READ_WITH_FRAGMENTS) *
-			g_fragments_size;
+		unsigned int nr = pagelist->type - PAGELIST_READ_WITH_FRAGMENTS;
+		char *fragments = g_fragments_base + nr * g_fragments_size;
 		int head_bytes, tail_bytes;
 
 		head_bytes = (g_cache_line_size - pagelist->offset) &
@@ -631,11 +879,8 @@ free_pagelist(struct vchiq_pagelist_info *pagelistinfo,
 			kunmap(pages[num_pages - 1]);
 		}
 
-		down(&g_free_fragments_mutex);
-		*(char **)fragments = g_free_fragments;
-		g_free_fragments = fragments;
-		up(&g_free_fragments_mutex);
-		up(&g_free_fragments_sema);
+		sbitmap_queue_clear(&g_free_fragments, nr,
+				    pagelistinfo->fragments_cpu);
 	}
 
 	/* Need to mark all the pages dirty. */
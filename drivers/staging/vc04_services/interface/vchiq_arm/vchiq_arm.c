@@ -21,6 +21,7 @@
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/compat.h>
+#include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/rcupdate.h>
 #include <linux/delay.h>
@@ -51,6 +52,16 @@
 int vchiq_arm_log_level = VCHIQ_LOG_DEFAULT;
 int vchiq_susp_log_level = VCHIQ_LOG_ERROR;
 
+/*
+ * service_callback() blocks until the process has made room in its
+ * completion or message queue. With this set, that wait holds up a
+ * per-service worker instead of the slot handler for every other service.
+ */
+static bool user_dispatch;
+module_param(user_dispatch, bool, 0644);
+MODULE_PARM_DESC(user_dispatch,
+		 "Deliver messages to userspace services from a worker");
+
 struct user_service {
 	struct vchiq_service *service;
 	void __user *userdata;
@@ -92,6 +103,11 @@ struct vchiq_instance {
 	struct list_head bulk_waiter_list;
 	struct mutex bulk_waiter_list_mutex;
 
+	/* Imported dma-bufs, most recently used first */
+	struct list_head dmabuf_imports;
+	struct mutex dmabuf_imports_mutex;
+	unsigned int num_dmabuf_imports;
+
 	struct vchiq_debugfs_node debugfs_node;
 };
 
@@ -144,7 +160,9 @@ static const char *const ioctl_names[] = {
 	"SET_SERVICE_OPTION",
 	"DUMP_PHYS_MEM",
 	"LIB_VERSION",
-	"CLOSE_DELIVERED"
+	"CLOSE_DELIVERED",
+	"QUEUE_BULK_TRANSMIT_DMABUF",
+	"QUEUE_BULK_RECEIVE_DMABUF"
 };
 
 vchiq_static_assert(ARRAY_SIZE(ioctl_names) ==
@@ -155,6 +173,10 @@ vchiq_blocking_bulk_transfer(unsigned int handle, void *data,
 	unsigned int size, enum vchiq_bulk_dir dir);
 
 #define VCHIQ_INIT_RETRIES 10
+
+/* Mapped dma-bufs kept per instance for reuse by later bulk transfers */
+#define VCHIQ_MAX_DMABUF_IMPORTS 32
+
 enum vchiq_status vchiq_initialise(struct vchiq_instance **instance_out)
 {
 	enum vchiq_status status = VCHIQ_ERROR;
@@ -303,7 +325,8 @@ static enum vchiq_status vchiq_add_service(
 		params,
 		srvstate,
 		instance,
-		NULL);
+		NULL,
+		0);
 
 	if (service) {
 		*phandle = service->handle;
@@ -338,7 +361,8 @@ enum vchiq_status vchiq_open_service(
 		params,
 		VCHIQ_SRVSTATE_OPENING,
 		instance,
-		NULL);
+		NULL,
+		0);
 
 	if (service) {
 		*phandle = service->handle;
@@ -841,7 +865,9 @@ static int vchiq_ioc_create_service(struct vchiq_instance *instance,
 	};
 	service = vchiq_add_service_internal(instance->state, &params,
 					     srvstate, instance,
-					     user_service_free);
+					     user_service_free,
+					     user_dispatch ?
+					     VCHIQ_SERVICE_FLAG_DISPATCH : 0);
 	if (!service) {
 		kfree(user_service);
 		return -EEXIST;
@@ -955,6 +981,7 @@ static int vchiq_ioc_dequeue_message(struct vchiq_instance *instance,
 
 static int vchiq_irq_queue_bulk_tx_rx(struct vchiq_instance *instance,
 				      struct vchiq_queue_bulk_transfer *args,
+				      const struct vchiq_bulk_dmabuf *dmabuf,
 				      enum vchiq_bulk_dir dir,
 				      enum vchiq_bulk_mode __user *mode)
 {
@@ -1011,8 +1038,14 @@ static int vchiq_irq_queue_bulk_tx_rx(struct vchiq_instance *instance,
 	 * accessing kernel data instead of user space, based on the
 	 * address.
 	 */
-	status = vchiq_bulk_transfer(args->handle, NULL, args->data, args->size,
-				     userdata, args->mode, dir);
+	if (dmabuf)
+		status = vchiq_bulk_transfer_dmabuf(args->handle, dmabuf,
+						    args->size, userdata,
+						    args->mode, dir);
+	else
+		status = vchiq_bulk_transfer(args->handle, NULL, args->data,
+					     args->size, userdata, args->mode,
+					     dir);
 
 	if (!waiter) {
 		ret = 0;
@@ -1054,6 +1087,88 @@ static int vchiq_irq_queue_bulk_tx_rx(struct vchiq_instance *instance,
 	return 0;
 }
 
+/*
+ * Returns a referenced import of the dma-buf behind @fd. The instance keeps
+ * its own reference on the most recently used imports, so repeated
+ * transfers from the same buffer reuse its attachment and DMA mapping.
+ */
+static struct vchiq_dmabuf_import *
+vchiq_instance_get_dmabuf(struct vchiq_instance *instance, int fd)
+{
+	struct vchiq_dmabuf_import *import;
+	struct dma_buf *dmabuf;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return ERR_CAST(dmabuf);
+
+	mutex_lock(&instance->dmabuf_imports_mutex);
+
+	list_for_each_entry(import, &instance->dmabuf_imports, list) {
+		if (import->dmabuf == dmabuf) {
+			list_move(&import->list, &instance->dmabuf_imports);
+			kref_get(&import->kref);
+			dma_buf_put(dmabuf);
+			goto out;
+		}
+	}
+
+	import = vchiq_platform_dmabuf_import(dmabuf);
+	if (IS_ERR(import)) {
+		dma_buf_put(dmabuf);
+		goto out;
+	}
+
+	if (instance->num_dmabuf_imports == VCHIQ_MAX_DMABUF_IMPORTS) {
+		struct vchiq_dmabuf_import *oldest =
+			list_last_entry(&instance->dmabuf_imports,
+					struct vchiq_dmabuf_import, list);
+
+		list_del(&oldest->list);
+		vchiq_platform_dmabuf_put(oldest);
+	} else {
+		instance->num_dmabuf_imports++;
+	}
+
+	list_add(&import->list, &instance->dmabuf_imports);
+	kref_get(&import->kref);
+
+out:
+	mutex_unlock(&instance->dmabuf_imports_mutex);
+
+	return import;
+}
+
+static int vchiq_ioc_queue_bulk_dmabuf(struct vchiq_instance *instance,
+				       struct vchiq_queue_bulk_dmabuf *args,
+				       enum vchiq_bulk_dir dir,
+				       enum vchiq_bulk_mode __user *mode)
+{
+	struct vchiq_queue_bulk_transfer bulk_args = {
+		.handle   = args->handle,
+		.size     = args->size,
+		.userdata = u64_to_user_ptr(args->userdata),
+		.mode     = args->mode,
+	};
+	struct vchiq_bulk_dmabuf dmabuf;
+	int ret;
+
+	if (args->reserved)
+		return -EINVAL;
+
+	dmabuf.import = vchiq_instance_get_dmabuf(instance, args->fd);
+	if (IS_ERR(dmabuf.import))
+		return PTR_ERR(dmabuf.import);
+	dmabuf.offset = args->offset;
+
+	ret = vchiq_irq_queue_bulk_tx_rx(instance, &bulk_args, &dmabuf,
+					 dir, mode);
+
+	vchiq_platform_dmabuf_put(dmabuf.import);
+
+	return ret;
+}
+
 /* read a user pointer value from an array pointers in user space */
 static inline int vchiq_get_user_ptr(void __user **buf, void __user *ubuf, int index)
 {
@@ -1445,10 +1560,29 @@ vchiq_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 
-		ret = vchiq_irq_queue_bulk_tx_rx(instance, &args,
+		ret = vchiq_irq_queue_bulk_tx_rx(instance, &args, NULL,
 						 dir, &argp->mode);
 	} break;
 
+	case VCHIQ_IOC_QUEUE_BULK_TRANSMIT_DMABUF:
+	case VCHIQ_IOC_QUEUE_BULK_RECEIVE_DMABUF: {
+		struct vchiq_queue_bulk_dmabuf args;
+		struct vchiq_queue_bulk_dmabuf __user *argp;
+
+		enum vchiq_bulk_dir dir =
+			(cmd == VCHIQ_IOC_QUEUE_BULK_TRANSMIT_DMABUF) ?
+			VCHIQ_BULK_TRANSMIT : VCHIQ_BULK_RECEIVE;
+
+		argp = (void __user *)arg;
+		if (copy_from_user(&args, argp, sizeof(args))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = vchiq_ioc_queue_bulk_dmabuf(instance, &args,
+						  dir, &argp->mode);
+	} break;
+
 	case VCHIQ_IOC_AWAIT_COMPLETION: {
 		struct vchiq_await_completion args;
 		struct vchiq_await_completion __user *argp;
@@ -1736,7 +1870,7 @@ vchiq_compat_ioctl_queue_bulk(struct file *file,
 		.mode	  = args32.mode,
 	};
 
-	return vchiq_irq_queue_bulk_tx_rx(file->private_data, &args,
+	return vchiq_irq_queue_bulk_tx_rx(file->private_data, &args, NULL,
 					  dir, &argp->mode);
 }
 
@@ -1887,6 +2021,8 @@ static int vchiq_open(struct inode *inode, struct file *file)
 	mutex_init(&instance->completion_mutex);
 	mutex_init(&instance->bulk_waiter_list_mutex);
 	INIT_LIST_HEAD(&instance->bulk_waiter_list);
+	mutex_init(&instance->dmabuf_imports_mutex);
+	INIT_LIST_HEAD(&instance->dmabuf_imports);
 
 	file->private_data = instance;
 
@@ -2001,6 +2137,17 @@ static int vchiq_release(struct inode *inode, struct file *file)
 		}
 	}
 
+	{
+		struct vchiq_dmabuf_import *import, *next;
+
+		/* In-flight bulks hold their own references. */
+		list_for_each_entry_safe(import, next,
+					 &instance->dmabuf_imports, list) {
+			list_del(&import->list);
+			vchiq_platform_dmabuf_put(import);
+		}
+	}
+
 	vchiq_debugfs_remove_instance(instance);
 
 	kfree(instance);
@@ -2812,6 +2959,7 @@ static int vchiq_remove(struct platform_device *pdev)
 	platform_device_unregister(bcm2835_codec);
 	platform_device_unregister(vcsm_cma);
 	vchiq_debugfs_deinit();
+	vchiq_dispatch_deinit();
 	device_destroy(vchiq_class, vchiq_devid);
 	cdev_del(&vchiq_cdev);
 
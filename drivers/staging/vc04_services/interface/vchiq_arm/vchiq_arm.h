@@ -62,6 +62,26 @@ extern int vchiq_susp_log_level;
 int vchiq_platform_init(struct platform_device *pdev,
 			struct vchiq_state *state);
 
+struct seq_file;
+void vchiq_platform_fragments_show(struct seq_file *f);
+
+struct dma_buf;
+struct dma_buf_attachment;
+struct sg_table;
+
+struct vchiq_dmabuf_import {
+	struct kref kref;
+	struct list_head list;	/* Entry in the owning instance's cache */
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+};
+
+struct vchiq_dmabuf_import *
+vchiq_platform_dmabuf_import(struct dma_buf *dmabuf);
+
+void vchiq_platform_dmabuf_put(struct vchiq_dmabuf_import *import);
+
 extern struct vchiq_state *
 vchiq_get_state(void);
 
@@ -10,8 +10,10 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/kref.h>
+#include <linux/moduleparam.h>
 #include <linux/rcupdate.h>
 #include <linux/sched/signal.h>
+#include <linux/seq_file.h>
 
 #include "vchiq_core.h"
 
@@ -554,6 +556,174 @@ request_poll(struct vchiq_state *state, struct vchiq_service *service,
 	remote_event_signal_local(&state->trigger_event, &state->local->trigger);
 }
 
+static struct workqueue_struct *vchiq_dispatch_wq;
+
+static int dispatch_cpu = -1;
+module_param(dispatch_cpu, int, 0644);
+MODULE_PARM_DESC(dispatch_cpu,
+		 "CPU that runs the services' dispatch workers (-1 = any)");
+
+static inline unsigned int
+dispatch_used(struct vchiq_service *service)
+{
+	return service->dispatch_insert -
+		smp_load_acquire(&service->dispatch_remove);
+}
+
+/* Called by the slot handler thread. Returns true if the message must wait
+** until the service's dispatch worker has drained its queue, either to make
+** room (need_empty false) or to keep the message in order behind those
+** already queued (need_empty true). The worker retriggers the slot handler
+** once it has made progress. */
+static bool
+dispatch_busy(struct vchiq_service *service, bool need_empty)
+{
+	unsigned int limit = need_empty ? 0 : VCHIQ_DISPATCH_QUEUE_SIZE - 1;
+
+	if (!service->dispatch || dispatch_used(service) <= limit)
+		return false;
+
+	atomic_set(&service->dispatch_blocked, 1);
+	smp_mb__after_atomic();
+	if (dispatch_used(service) <= limit) {
+		atomic_set(&service->dispatch_blocked, 0);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+queue_dispatch(struct vchiq_service *service, unsigned long delay)
+{
+	/* Each queued instance of the work owns a service reference */
+	lock_service(service);
+	if (!queue_delayed_work_on(service->dispatch_cpu, vchiq_dispatch_wq,
+				   &service->dispatch_work, delay))
+		unlock_service(service);
+}
+
+/* Called by the slot handler thread, after dispatch_busy() */
+static void
+dispatch_message(struct vchiq_service *service, struct vchiq_header *header)
+{
+	unsigned int insert = service->dispatch_insert;
+	struct vchiq_dispatch_entry *entry =
+		&service->dispatch_queue[insert & (VCHIQ_DISPATCH_QUEUE_SIZE - 1)];
+
+	entry->header = header;
+	entry->queued = ktime_get();
+	smp_store_release(&service->dispatch_insert, insert + 1);
+
+	queue_dispatch(service, 0);
+}
+
+static void
+dispatch_work_func(struct work_struct *work)
+{
+	struct vchiq_service *service =
+		container_of(to_delayed_work(work), struct vchiq_service,
+			     dispatch_work);
+	struct vchiq_state *state = service->state;
+	unsigned int remove = service->dispatch_remove;
+
+	while (remove != smp_load_acquire(&service->dispatch_insert)) {
+		struct vchiq_dispatch_entry *entry =
+			&service->dispatch_queue[remove &
+				(VCHIQ_DISPATCH_QUEUE_SIZE - 1)];
+		s64 latency = ktime_us_delta(ktime_get(), entry->queued);
+
+		if (service->srvstate != VCHIQ_SRVSTATE_OPEN) {
+			vchiq_release_message(service->handle, entry->header);
+		} else if (make_service_callback(service,
+				VCHIQ_MESSAGE_AVAILABLE, entry->header,
+				NULL) == VCHIQ_RETRY) {
+			/* Back off before trying again, keeping the message
+			** order. Messages queued meanwhile don't shorten the
+			** wait. */
+			service->dispatch_retry_delay =
+				service->dispatch_retry_delay ?
+				min_t(unsigned long,
+				      service->dispatch_retry_delay * 2,
+				      VCHIQ_DISPATCH_RETRY_MAX) : 1;
+			queue_dispatch(service, service->dispatch_retry_delay);
+			break;
+		}
+		service->dispatch_retry_delay = 0;
+
+		service->dispatch_latency[min_t(int, fls64(max_t(s64, latency, 0)),
+			VCHIQ_DISPATCH_LATENCY_BUCKETS - 1)]++;
+
+		smp_store_release(&service->dispatch_remove, ++remove);
+
+		if (atomic_xchg(&service->dispatch_blocked, 0))
+			remote_event_signal_local(&state->trigger_event,
+						  &state->local->trigger);
+	}
+
+	unlock_service(service);
+}
+
+/* Called by the slot handler thread when the service closes or is freed.
+** Waits for a callback in progress and drops a queued or backing-off worker.
+** The messages it had not delivered are forgotten here and handed back to
+** the VPU by release_service_messages(). */
+static void
+dispatch_cancel(struct vchiq_service *service)
+{
+	if (!service->dispatch)
+		return;
+
+	/* Drop the reference owned by the queued work */
+	if (cancel_delayed_work_sync(&service->dispatch_work))
+		unlock_service(service);
+
+	smp_store_release(&service->dispatch_remove, service->dispatch_insert);
+	service->dispatch_retry_delay = 0;
+	atomic_set(&service->dispatch_blocked, 0);
+}
+
+void
+vchiq_dispatch_deinit(void)
+{
+	if (vchiq_dispatch_wq) {
+		destroy_workqueue(vchiq_dispatch_wq);
+		vchiq_dispatch_wq = NULL;
+	}
+}
+
+void
+vchiq_dispatch_stats_show(struct seq_file *f, struct vchiq_state *state)
+{
+	int i, j;
+
+	rcu_read_lock();
+	for (i = 0; i < state->unused_service; i++) {
+		struct vchiq_service *service =
+			rcu_dereference(state->services[i]);
+
+		if (!service || !service->dispatch)
+			continue;
+
+		seq_printf(f, "%c%c%c%c:%d queued=%u cpu=%d\n",
+			   VCHIQ_FOURCC_AS_4CHARS(service->base.fourcc),
+			   service->localport, dispatch_used(service),
+			   (service->dispatch_cpu == WORK_CPU_UNBOUND) ?
+				-1 : service->dispatch_cpu);
+		for (j = 0; j < VCHIQ_DISPATCH_LATENCY_BUCKETS; j++) {
+			if (!service->dispatch_latency[j])
+				continue;
+			seq_printf(f, "  %s%8lluus %u\n",
+				   (j == VCHIQ_DISPATCH_LATENCY_BUCKETS - 1) ?
+					">=" : "< ",
+				   (j == VCHIQ_DISPATCH_LATENCY_BUCKETS - 1) ?
+					1ULL << (j - 1) : 1ULL << j,
+				   service->dispatch_latency[j]);
+		}
+	}
+	rcu_read_unlock();
+}
+
 /* Called from queue_message, by the slot handler and application threads,
 ** with slot_mutex held */
 static struct vchiq_header *
@@ -1665,6 +1835,9 @@ parse_rx_slots(struct vchiq_state *state)
 		case VCHIQ_MSG_CLOSE:
 			WARN_ON(size != 0); /* There should be no data */
 
+			if (dispatch_busy(service, true))
+				goto bail_not_ready;
+
 			vchiq_log_info(vchiq_core_log_level,
 				"%d: prs CLOSE@%pK (%d->%d)",
 				state->id, header, remoteport, localport);
@@ -1689,10 +1862,14 @@ parse_rx_slots(struct vchiq_state *state)
 			if ((service->remoteport == remoteport)
 				&& (service->srvstate ==
 				VCHIQ_SRVSTATE_OPEN)) {
+				if (dispatch_busy(service, false))
+					goto bail_not_ready;
 				header->msgid = msgid | VCHIQ_MSGID_CLAIMED;
 				claim_slot(state->rx_info);
 				DEBUG_TRACE(PARSE_LINE);
-				if (make_service_callback(service,
+				if (service->dispatch) {
+					dispatch_message(service, header);
+				} else if (make_service_callback(service,
 					VCHIQ_MESSAGE_AVAILABLE, header,
 					NULL) == VCHIQ_RETRY) {
 					DEBUG_TRACE(PARSE_LINE);
@@ -1732,6 +1909,11 @@ parse_rx_slots(struct vchiq_state *state)
 				queue = (type == VCHIQ_MSG_BULK_RX_DONE) ?
 					&service->bulk_rx : &service->bulk_tx;
 
+				/* Keep bulk completions behind any messages
+				** still waiting for the dispatch worker. */
+				if (dispatch_busy(service, true))
+					goto bail_not_ready;
+
 				DEBUG_TRACE(PARSE_LINE);
 				if (mutex_lock_killable(&service->bulk_mutex)) {
 					DEBUG_TRACE(PARSE_LINE);
@@ -2216,6 +2398,13 @@ vchiq_init_state(struct vchiq_state *state, struct vchiq_slot_zero *slot_zero)
 	if (status != VCHIQ_SUCCESS)
 		return VCHIQ_ERROR;
 
+	if (!vchiq_dispatch_wq) {
+		vchiq_dispatch_wq = alloc_workqueue("vchiq-dispatch",
+						    WQ_HIGHPRI, 0);
+		if (!vchiq_dispatch_wq)
+			return VCHIQ_ERROR;
+	}
+
 	/*
 		bring up slot handler thread
 	 */
@@ -2228,7 +2417,7 @@ vchiq_init_state(struct vchiq_state *state, struct vchiq_slot_zero *slot_zero)
 		vchiq_loud_error_header();
 		vchiq_loud_error("couldn't create thread %s", threadname);
 		vchiq_loud_error_footer();
-		return VCHIQ_ERROR;
+		goto fail_free_dispatch_wq;
 	}
 	set_user_nice(state->slot_handler_thread, -19);
 
@@ -2271,6 +2460,8 @@ vchiq_init_state(struct vchiq_state *state, struct vchiq_slot_zero *slot_zero)
 	kthread_stop(state->recycle_thread);
 fail_free_handler_thread:
 	kthread_stop(state->slot_handler_thread);
+fail_free_dispatch_wq:
+	vchiq_dispatch_deinit();
 
 	return VCHIQ_ERROR;
 }
@@ -2331,11 +2522,13 @@ struct vchiq_service *
 vchiq_add_service_internal(struct vchiq_state *state,
 			   const struct vchiq_service_params_kernel *params,
 			   int srvstate, struct vchiq_instance *instance,
-			   vchiq_userdata_term userdata_term)
+			   vchiq_userdata_term userdata_term,
+			   unsigned int flags)
 {
 	struct vchiq_service *service;
 	struct vchiq_service __rcu **pservice = NULL;
 	struct vchiq_service_quota *service_quota;
+	int cpu = READ_ONCE(dispatch_cpu);
 	int ret;
 	int i;
 
@@ -2381,6 +2574,16 @@ vchiq_add_service_internal(struct vchiq_state *state,
 	mutex_init(&service->bulk_mutex);
 	memset(&service->stats, 0, sizeof(service->stats));
 	memset(&service->msg_queue, 0, sizeof(service->msg_queue));
+	service->dispatch = !!(flags & VCHIQ_SERVICE_FLAG_DISPATCH);
+	service->dispatch_cpu = (cpu >= 0 && cpu < nr_cpu_ids &&
+				 cpu_online(cpu)) ? cpu : WORK_CPU_UNBOUND;
+	service->dispatch_retry_delay = 0;
+	service->dispatch_insert = 0;
+	service->dispatch_remove = 0;
+	atomic_set(&service->dispatch_blocked, 0);
+	INIT_DELAYED_WORK(&service->dispatch_work, dispatch_work_func);
+	memset(&service->dispatch_latency, 0,
+	       sizeof(service->dispatch_latency));
 
 	/* Although it is perfectly possible to use a spinlock
 	** to protect the creation of services, it is overkill as it
@@ -2717,6 +2920,7 @@ vchiq_close_service_internal(struct vchiq_service *service, int close_recvd)
 				status = VCHIQ_RETRY;
 		}
 
+		dispatch_cancel(service);
 		release_service_messages(service);
 
 		if (status == VCHIQ_SUCCESS)
@@ -2827,6 +3031,7 @@ vchiq_free_service_internal(struct vchiq_service *service)
 		return;
 	}
 
+	dispatch_cancel(service);
 	vchiq_set_service_state(service, VCHIQ_SRVSTATE_FREE);
 
 	complete(&service->remove_event);
@@ -3007,18 +3212,13 @@ vchiq_remove_service(unsigned int handle)
 	return status;
 }
 
-/* This function may be called by kernel threads or user threads.
- * User threads may receive VCHIQ_RETRY to indicate that a signal has been
- * received and the call should be retried after being returned to user
- * context.
- * When called in blocking mode, the userdata field points to a bulk_waiter
- * structure.
- */
-enum vchiq_status vchiq_bulk_transfer(unsigned int handle,
-				   void *offset, void __user *uoffset,
-				   int size, void *userdata,
-				   enum vchiq_bulk_mode mode,
-				   enum vchiq_bulk_dir dir)
+static enum vchiq_status
+vchiq_bulk_transfer_common(unsigned int handle,
+			   void *offset, void __user *uoffset,
+			   const struct vchiq_bulk_dmabuf *dmabuf,
+			   int size, void *userdata,
+			   enum vchiq_bulk_mode mode,
+			   enum vchiq_bulk_dir dir)
 {
 	struct vchiq_service *service = find_service_by_handle(handle);
 	struct vchiq_bulk_queue *queue;
@@ -3032,7 +3232,7 @@ enum vchiq_status vchiq_bulk_transfer(unsigned int handle,
 	int payload[2];
 
 	if (!service || service->srvstate != VCHIQ_SRVSTATE_OPEN ||
-	    (!offset && !uoffset) ||
+	    (!offset && !uoffset && !dmabuf) ||
 	    vchiq_check_service(service) != VCHIQ_SUCCESS)
 		goto error_exit;
 
@@ -3089,7 +3289,7 @@ enum vchiq_status vchiq_bulk_transfer(unsigned int handle,
 	bulk->size = size;
 	bulk->actual = VCHIQ_BULK_ACTUAL_ABORTED;
 
-	if (vchiq_prepare_bulk_data(bulk, offset, uoffset, size, dir)
+	if (vchiq_prepare_bulk_data(bulk, offset, uoffset, dmabuf, size, dir)
 			!= VCHIQ_SUCCESS)
 		goto unlock_error_exit;
 
@@ -3165,6 +3365,37 @@ enum vchiq_status vchiq_bulk_transfer(unsigned int handle,
 	return status;
 }
 
+/* This function may be called by kernel threads or user threads.
+ * User threads may receive VCHIQ_RETRY to indicate that a signal has been
+ * received and the call should be retried after being returned to user
+ * context.
+ * When called in blocking mode, the userdata field points to a bulk_waiter
+ * structure.
+ */
+enum vchiq_status vchiq_bulk_transfer(unsigned int handle,
+				   void *offset, void __user *uoffset,
+				   int size, void *userdata,
+				   enum vchiq_bulk_mode mode,
+				   enum vchiq_bulk_dir dir)
+{
+	return vchiq_bulk_transfer_common(handle, offset, uoffset, NULL, size,
+					  userdata, mode, dir);
+}
+
+/* As vchiq_bulk_transfer(), but the data lives in an imported dma-buf
+ * whose DMA mapping is reused rather than set up for every transfer.
+ */
+enum vchiq_status
+vchiq_bulk_transfer_dmabuf(unsigned int handle,
+			   const struct vchiq_bulk_dmabuf *dmabuf,
+			   int size, void *userdata,
+			   enum vchiq_bulk_mode mode,
+			   enum vchiq_bulk_dir dir)
+{
+	return vchiq_bulk_transfer_common(handle, NULL, NULL, dmabuf, size,
+					  userdata, mode, dir);
+}
+
 enum vchiq_status
 vchiq_queue_message(unsigned int handle,
 		    ssize_t (*copy_callback)(void *context, void *dest,
@@ -8,8 +8,10 @@
 #include <linux/completion.h>
 #include <linux/kthread.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
 #include <linux/rcupdate.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <linux/raspberrypi/vchiq.h>
 
 #include "vchiq_cfg.h"
@@ -28,6 +30,16 @@
 
 #define VCHIQ_SERVICE_HANDLE_INVALID 0
 
+/* vchiq_add_service_internal() flags */
+#define VCHIQ_SERVICE_FLAG_DISPATCH	0x1	/* deliver from a worker */
+
+/* Messages that may be waiting for a service's dispatch worker */
+#define VCHIQ_DISPATCH_QUEUE_SIZE	64
+/* Longest back-off of a dispatch worker whose callback asked to retry */
+#define VCHIQ_DISPATCH_RETRY_MAX	(HZ / 10)
+/* Log2 microsecond buckets of the dispatch latency histogram */
+#define VCHIQ_DISPATCH_LATENCY_BUCKETS	16
+
 #define VCHIQ_SLOT_SIZE     4096
 #define VCHIQ_MAX_MSG_SIZE  (VCHIQ_SLOT_SIZE - sizeof(struct vchiq_header))
 
@@ -227,6 +239,14 @@ enum vchiq_bulk_dir {
 
 typedef void (*vchiq_userdata_term)(void *userdata);
 
+struct vchiq_dmabuf_import;
+
+/* A byte range of a dma-buf imported with vchiq_platform_dmabuf_import() */
+struct vchiq_bulk_dmabuf {
+	struct vchiq_dmabuf_import *import;
+	unsigned int offset;
+};
+
 struct vchiq_bulk {
 	short mode;
 	short dir;
@@ -319,6 +339,22 @@ struct vchiq_service {
 	struct completion msg_queue_pop;
 	struct completion msg_queue_push;
 	struct vchiq_header *msg_queue[VCHIQ_MAX_SLOTS];
+
+	/* Off-thread message delivery, see VCHIQ_SERVICE_FLAG_DISPATCH.
+	** The slot handler is the only producer and dispatch_work the only
+	** consumer of dispatch_queue. */
+	int dispatch;
+	int dispatch_cpu;
+	unsigned long dispatch_retry_delay;
+	unsigned int dispatch_insert;
+	unsigned int dispatch_remove;
+	atomic_t dispatch_blocked;
+	struct delayed_work dispatch_work;
+	struct vchiq_dispatch_entry {
+		struct vchiq_header *header;
+		ktime_t queued;
+	} dispatch_queue[VCHIQ_DISPATCH_QUEUE_SIZE];
+	u32 dispatch_latency[VCHIQ_DISPATCH_LATENCY_BUCKETS];
 };
 
 /* The quota information is outside struct vchiq_service so that it can
@@ -538,7 +574,8 @@ struct vchiq_service *
 vchiq_add_service_internal(struct vchiq_state *state,
 			   const struct vchiq_service_params_kernel *params,
 			   int srvstate, struct vchiq_instance *instance,
-			   vchiq_userdata_term userdata_term);
+			   vchiq_userdata_term userdata_term,
+			   unsigned int flags);
 
 extern enum vchiq_status
 vchiq_open_service_internal(struct vchiq_service *service, int client_id);
@@ -563,6 +600,20 @@ vchiq_bulk_transfer(unsigned int handle, void *offset, void __user *uoffset,
 		    int size, void *userdata, enum vchiq_bulk_mode mode,
 		    enum vchiq_bulk_dir dir);
 
+extern void
+vchiq_dispatch_deinit(void);
+
+struct seq_file;
+extern void
+vchiq_dispatch_stats_show(struct seq_file *f, struct vchiq_state *state);
+
+extern enum vchiq_status
+vchiq_bulk_transfer_dmabuf(unsigned int handle,
+			   const struct vchiq_bulk_dmabuf *dmabuf,
+			   int size, void *userdata,
+			   enum vchiq_bulk_mode mode,
+			   enum vchiq_bulk_dir dir);
+
 extern int
 vchiq_dump_state(void *dump_context, struct vchiq_state *state);
 
@@ -633,7 +684,9 @@ vchiq_queue_message(unsigned int handle,
 
 extern enum vchiq_status
 vchiq_prepare_bulk_data(struct vchiq_bulk *bulk, void *offset,
-			void __user *uoffset, int size, int dir);
+			void __user *uoffset,
+			const struct vchiq_bulk_dmabuf *dmabuf,
+			int size, int dir);
 
 extern void
 vchiq_complete_bulk(struct vchiq_bulk *bulk);
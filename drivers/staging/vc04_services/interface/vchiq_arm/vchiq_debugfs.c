@@ -183,6 +183,25 @@ static const struct file_operations debugfs_trace_fops = {
 	.release	= single_release,
 };
 
+static int debugfs_fragments_show(struct seq_file *f, void *offset)
+{
+	vchiq_platform_fragments_show(f);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(debugfs_fragments);
+
+static int debugfs_dispatch_show(struct seq_file *f, void *offset)
+{
+	struct vchiq_state *state = vchiq_get_state();
+
+	if (state)
+		vchiq_dispatch_stats_show(f, state);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(debugfs_dispatch);
+
 /* add an instance (process) to the debugfs entries */
 void vchiq_debugfs_add_instance(struct vchiq_instance *instance)
 {
@@ -217,6 +236,11 @@ void vchiq_debugfs_init(void)
 	vchiq_dbg_dir = debugfs_create_dir("vchiq", NULL);
 	vchiq_dbg_clients = debugfs_create_dir("clients", vchiq_dbg_dir);
 
+	debugfs_create_file("fragments", 0444, vchiq_dbg_dir, NULL,
+			    &debugfs_fragments_fops);
+	debugfs_create_file("dispatch", 0444, vchiq_dbg_dir, NULL,
+			    &debugfs_dispatch_fops);
+
 	/* create an entry under <debugfs>/vchiq/log for each log category */
 	dir = debugfs_create_dir("log", vchiq_dbg_dir);
 
@@ -42,6 +42,17 @@ struct vchiq_queue_bulk_transfer {
 	enum vchiq_bulk_mode mode;
 };
 
+/* Fixed layout, so no separate compat version is needed. */
+struct vchiq_queue_bulk_dmabuf {
+	__u64 userdata;
+	unsigned int handle;
+	int fd;
+	unsigned int offset;
+	unsigned int size;
+	enum vchiq_bulk_mode mode;
+	unsigned int reserved;
+};
+
 struct vchiq_completion_data {
 	enum vchiq_reason reason;
 	struct vchiq_header __user *header;
@@ -107,6 +118,10 @@ struct vchiq_dump_mem {
 	_IOW(VCHIQ_IOC_MAGIC,  15, struct vchiq_dump_mem)
 #define VCHIQ_IOC_LIB_VERSION          _IO(VCHIQ_IOC_MAGIC,   16)
 #define VCHIQ_IOC_CLOSE_DELIVERED      _IO(VCHIQ_IOC_MAGIC,   17)
-#define VCHIQ_IOC_MAX                  17
+#define VCHIQ_IOC_QUEUE_BULK_TRANSMIT_DMABUF \
+	_IOWR(VCHIQ_IOC_MAGIC, 18, struct vchiq_queue_bulk_dmabuf)
+#define VCHIQ_IOC_QUEUE_BULK_RECEIVE_DMABUF \
+	_IOWR(VCHIQ_IOC_MAGIC, 19, struct vchiq_queue_bulk_dmabuf)
+#define VCHIQ_IOC_MAX                  19
 
 #endif
@@ -82,6 +82,7 @@ struct fb_alloc_tags {
 struct bcm2708_fb_stats {
 	struct debugfs_regset32 regset;
 	u32 dma_copies;
+	u32 dma_fills;
 	u32 dma_irqs;
 };
 
@@ -159,6 +160,7 @@ static int bcm2708_fb_debugfs_init(struct bcm2708_fb *fb)
 
 	static struct debugfs_reg32 stats_registers[] = {
 	{"dma_copies", offsetof(struct bcm2708_fb_stats, dma_copies)},
+	{"dma_fills",  offsetof(struct bcm2708_fb_stats, dma_fills)},
 	{"dma_irqs",   offsetof(struct bcm2708_fb_stats, dma_irqs)},
 	};
 
@@ -603,6 +605,35 @@ static int bcm2708_fb_pan_display(struct fb_var_screeninfo *var,
 	return result;
 }
 
+/*
+ * Run the control block chain at cb_handle and wait for it to finish.
+ * @last_cb is the final block of the chain, @pixels the size of the
+ * operation. Called with dma_mutex held. fbcon can draw from
+ * console_unlock() with interrupts off, so only sleep when allowed to.
+ */
+static void bcm2708_fb_dma_run(struct bcm2708_fb_dev *fbdev,
+			       struct bcm2708_dma_cb *last_cb, int pixels)
+{
+	/* end of dma control blocks chain */
+	last_cb->next = 0;
+
+	if (pixels < dma_busy_wait_threshold || !preemptible() ||
+	    irqs_disabled()) {
+		bcm_dma_start(fbdev->dma_chan_base, fbdev->cb_handle);
+		bcm_dma_wait_idle(fbdev->dma_chan_base);
+	} else {
+		void __iomem *local_dma_chan = fbdev->dma_chan_base;
+
+		last_cb->info |= BCM2708_DMA_INT_EN;
+		bcm_dma_start(fbdev->dma_chan_base, fbdev->cb_handle);
+		while (bcm_dma_is_busy(local_dma_chan)) {
+			wait_event_interruptible(fbdev->dma_waitq,
+						 !bcm_dma_is_busy(local_dma_chan));
+		}
+		fbdev->dma_stats.dma_irqs++;
+	}
+}
+
 static void dma_memcpy(struct bcm2708_fb *fb, dma_addr_t dst, dma_addr_t src,
 		       int size)
 {
@@ -619,26 +650,12 @@ static void dma_memcpy(struct bcm2708_fb *fb, dma_addr_t dst, dma_addr_t src,
 	cb->stride = 0;
 	cb->pad[0] = 0;
 	cb->pad[1] = 0;
-	cb->next = 0;
 
 	// Not sure what to do if this gets a signal whilst waiting
 	if (mutex_lock_interruptible(&fbdev->dma_mutex))
 		return;
 
-	if (size < dma_busy_wait_threshold) {
-		bcm_dma_start(fbdev->dma_chan_base, fbdev->cb_handle);
-		bcm_dma_wait_idle(fbdev->dma_chan_base);
-	} else {
-		void __iomem *local_dma_chan = fbdev->dma_chan_base;
-
-		cb->info |= BCM2708_DMA_INT_EN;
-		bcm_dma_start(fbdev->dma_chan_base, fbdev->cb_handle);
-		while (bcm_dma_is_busy(local_dma_chan)) {
-			wait_event_interruptible(fbdev->dma_waitq,
-						 !bcm_dma_is_busy(local_dma_chan));
-		}
-		fbdev->dma_stats.dma_irqs++;
-	}
+	bcm2708_fb_dma_run(fbdev, cb, size);
 	fbdev->dma_stats.dma_copies++;
 
 	mutex_unlock(&fbdev->dma_mutex);
@@ -790,12 +807,6 @@ static int bcm2708_compat_ioctl(struct fb_info *info, unsigned int cmd,
 }
 #endif
 
-static void bcm2708_fb_fillrect(struct fb_info *info,
-				const struct fb_fillrect *rect)
-{
-	cfb_fillrect(info, rect);
-}
-
 /* A helper function for configuring dma control block */
 static void set_dma_cb(struct bcm2708_dma_cb *cb,
 		int        burst_size,
@@ -822,6 +833,73 @@ static void set_dma_cb(struct bcm2708_dma_cb *cb,
 	cb->pad[1] = 0;
 }
 
+static void bcm2708_fb_fillrect(struct fb_info *info,
+				const struct fb_fillrect *rect)
+{
+	struct bcm2708_fb *fb = to_bcm2708(info);
+	struct bcm2708_fb_dev *fbdev = fb->fbdev;
+	struct bcm2708_dma_cb *cb = fbdev->cb_base;
+	int bytes_per_pixel = (info->var.bits_per_pixel + 7) >> 3;
+	/* The fill pattern lives in the scratch area after the control blocks */
+	u32 *pattern = fbdev->cb_base + 16 * 1024;
+	dma_addr_t pattern_pa = fbdev->cb_handle + 16 * 1024;
+
+	/* Channel 0 supports larger bursts and is a bit faster */
+	int burst_size = (fbdev->dma_chan == 0) ? 8 : 2;
+	int line_length = fb->fb.fix.line_length;
+	u32 color;
+	int i;
+
+	/*
+	 * The DMA engine repeats a fixed 16 byte source, so only plain
+	 * fills with pixel sizes that tile it can be offloaded. Anything
+	 * else, or DMA being busy with another FB, uses cfb_fillrect.
+	 */
+	if (rect->rop != ROP_COPY ||
+	    (bytes_per_pixel != 1 && bytes_per_pixel != 2 &&
+	     bytes_per_pixel != 4) ||
+	    rect->width == 0 || rect->height == 0 ||
+	    rect->dx >= info->var.xres || rect->dy >= info->var.yres ||
+	    rect->width > info->var.xres - rect->dx ||
+	    rect->height > info->var.yres - rect->dy ||
+	    !mutex_trylock(&fbdev->dma_mutex)) {
+		cfb_fillrect(info, rect);
+		return;
+	}
+
+	if (info->fix.visual == FB_VISUAL_TRUECOLOR ||
+	    info->fix.visual == FB_VISUAL_DIRECTCOLOR)
+		color = ((u32 *)info->pseudo_palette)[rect->color];
+	else
+		color = rect->color;
+
+	if (bytes_per_pixel == 1)
+		color = (color & 0xff) * 0x01010101;
+	else if (bytes_per_pixel == 2)
+		color = (color & 0xffff) * 0x00010001;
+
+	for (i = 0; i < 4; i++)
+		pattern[i] = color;
+
+	/* 2D mode with a non-incrementing source and a zero source stride */
+	cb->info = BCM2708_DMA_BURST(burst_size) | BCM2708_DMA_S_WIDTH |
+		   BCM2708_DMA_D_WIDTH | BCM2708_DMA_D_INC |
+		   BCM2708_DMA_TDMODE;
+	cb->dst = fb->fb_bus_address + rect->dy * line_length +
+		  bytes_per_pixel * rect->dx;
+	cb->src = pattern_pa;
+	cb->length = ((rect->height - 1) << 16) |
+		     (rect->width * bytes_per_pixel);
+	cb->stride = (line_length - rect->width * bytes_per_pixel) << 16;
+	cb->pad[0] = 0;
+	cb->pad[1] = 0;
+
+	bcm2708_fb_dma_run(fbdev, cb, rect->width * rect->height);
+	fbdev->dma_stats.dma_fills++;
+
+	mutex_unlock(&fbdev->dma_mutex);
+}
+
 static void bcm2708_fb_copyarea(struct fb_info *info,
 				const struct fb_copyarea *region)
 {
@@ -835,10 +913,11 @@ static void bcm2708_fb_copyarea(struct fb_info *info,
 	int pixels = region->width * region->height;
 
 	/* If DMA is currently in use (ie being used on another FB), then
-	 * rather than wait for it to finish, just use the cfb_copyarea
+	 * rather than wait for it to finish, just use the cfb_copyarea.
+	 * The lock is tried last so that it is only taken when the DMA
+	 * path is actually used.
 	 */
-	if (!mutex_trylock(&fbdev->dma_mutex) ||
-	    bytes_per_pixel > 4 ||
+	if (bytes_per_pixel > 4 ||
 	    info->var.xres * info->var.yres > 1920 * 1200 ||
 	    region->width <= 0 || region->width > info->var.xres ||
 	    region->height <= 0 || region->height > info->var.yres ||
@@ -849,7 +928,8 @@ static void bcm2708_fb_copyarea(struct fb_info *info,
 	    region->sx + region->width > info->var.xres ||
 	    region->dx + region->width > info->var.xres ||
 	    region->sy + region->height > info->var.yres ||
-	    region->dy + region->height > info->var.yres) {
+	    region->dy + region->height > info->var.yres ||
+	    !mutex_trylock(&fbdev->dma_mutex)) {
 		cfb_copyarea(info, region);
 		return;
 	}
@@ -925,23 +1005,7 @@ static void bcm2708_fb_copyarea(struct fb_info *info,
 			   region->height);
 	}
 
-	/* end of dma control blocks chain */
-	cb->next = 0;
-
-	if (pixels < dma_busy_wait_threshold) {
-		bcm_dma_start(fbdev->dma_chan_base, fbdev->cb_handle);
-		bcm_dma_wait_idle(fbdev->dma_chan_base);
-	} else {
-		void __iomem *local_dma_chan = fbdev->dma_chan_base;
-
-		cb->info |= BCM2708_DMA_INT_EN;
-		bcm_dma_start(fbdev->dma_chan_base, fbdev->cb_handle);
-		while (bcm_dma_is_busy(local_dma_chan)) {
-			wait_event_interruptible(fbdev->dma_waitq,
-						 !bcm_dma_is_busy(local_dma_chan));
-		}
-		fbdev->dma_stats.dma_irqs++;
-	}
+	bcm2708_fb_dma_run(fbdev, cb, pixels);
 	fbdev->dma_stats.dma_copies++;
 
 	mutex_unlock(&fbdev->dma_mutex);
@@ -116,7 +116,8 @@ static inline bool watchdog_need_worker(struct watchdog_device *wdd)
 		(t && !watchdog_active(wdd) && watchdog_hw_running(wdd));
 }
 
-static ktime_t watchdog_next_keepalive(struct watchdog_device *wdd)
+static ktime_t watchdog_next_keepalive(struct watchdog_device *wdd,
+				       u64 *slack)
 {
 	struct watchdog_core_data *wd_data = wdd->wd_data;
 	unsigned int timeout_ms = wdd->timeout * 1000;
@@ -141,8 +142,20 @@ static ktime_t watchdog_next_keepalive(struct watchdog_device *wdd)
 	 */
 	last_heartbeat = ktime_sub(virt_timeout, ms_to_ktime(hw_heartbeat_ms));
 	latest_heartbeat = ktime_sub(last_heartbeat, ktime_get());
-	if (ktime_before(latest_heartbeat, keepalive_interval))
+	if (ktime_before(latest_heartbeat, keepalive_interval)) {
+		*slack = 0;
 		return latest_heartbeat;
+	}
+
+	/*
+	 * A regular keepalive only has to arrive within hw_heartbeat_ms,
+	 * so let it fire up to a quarter of the interval late and share
+	 * a wakeup with some other timer, as long as that does not run
+	 * past the last heartbeat.
+	 */
+	*slack = min(ktime_to_ns(keepalive_interval) / 4,
+		     ktime_to_ns(ktime_sub(latest_heartbeat,
+					   keepalive_interval)));
 	return keepalive_interval;
 }
 
@@ -151,11 +164,12 @@ static inline void watchdog_update_worker(struct watchdog_device *wdd)
 	struct watchdog_core_data *wd_data = wdd->wd_data;
 
 	if (watchdog_need_worker(wdd)) {
-		ktime_t t = watchdog_next_keepalive(wdd);
+		u64 slack;
+		ktime_t t = watchdog_next_keepalive(wdd, &slack);
 
 		if (t > 0)
-			hrtimer_start(&wd_data->timer, t,
-				      HRTIMER_MODE_REL_HARD);
+			hrtimer_start_range_ns(&wd_data->timer, t, slack,
+					       HRTIMER_MODE_REL_HARD);
 	} else {
 		hrtimer_cancel(&wd_data->timer);
 	}
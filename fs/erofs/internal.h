@@ -53,6 +53,9 @@ struct erofs_fs_context {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* fall back to synchronous readahead once endio ran in atomic context */
+	bool readahead_sync_decompress;
 #endif
 	unsigned int mount_opt;
 };
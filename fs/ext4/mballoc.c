@@ -3009,6 +3009,10 @@ int ext4_mb_release(struct super_block *sb)
 		       "mballoc: %u preallocated, %u discarded",
 				atomic_read(&sbi->s_mb_preallocated),
 				atomic_read(&sbi->s_mb_discarded));
+		ext4_msg(sb, KERN_INFO,
+		       "mballoc: %u inode pa hits, %u group pa hits",
+				atomic_read(&sbi->s_bal_pa_hits),
+				atomic_read(&sbi->s_bal_lg_pa_hits));
 	}
 
 	free_percpu(sbi->s_locality_groups);
@@ -3780,6 +3784,8 @@ ext4_mb_use_preallocated(struct ext4_allocation_context *ac)
 			spin_unlock(&pa->pa_lock);
 			ac->ac_criteria = 10;
 			rcu_read_unlock();
+			if (sbi->s_mb_stats)
+				atomic_inc(&sbi->s_bal_pa_hits);
 			return true;
 		}
 		spin_unlock(&pa->pa_lock);
@@ -3822,6 +3828,8 @@ ext4_mb_use_preallocated(struct ext4_allocation_context *ac)
 	if (cpa) {
 		ext4_mb_use_group_pa(ac, cpa);
 		ac->ac_criteria = 20;
+		if (sbi->s_mb_stats)
+			atomic_inc(&sbi->s_bal_lg_pa_hits);
 		return true;
 	}
 	return false;
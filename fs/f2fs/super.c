@@ -3446,6 +3446,23 @@ static void f2fs_tuning_parameters(struct f2fs_sb_info *sbi)
 		F2FS_OPTION(sbi).alloc_mode = ALLOC_MODE_REUSE;
 		sm_i->dcc_info->discard_granularity = 1;
 		sm_i->ipu_policy = 1 << F2FS_IPU_FORCE;
+	} else if (!f2fs_is_multi_device(sbi) &&
+			blk_queue_discard(bdev_get_queue(sbi->sb->s_bdev))) {
+		struct request_queue *q = bdev_get_queue(sbi->sb->s_bdev);
+		unsigned int erase_blks =
+			q->limits.discard_granularity >> F2FS_BLKSIZE_BITS;
+
+		/*
+		 * Devices reporting a large erase unit (e.g. SD cards) handle
+		 * partial-unit discards poorly, so only issue whole units.
+		 */
+		if (erase_blks > sm_i->dcc_info->discard_granularity)
+			sm_i->dcc_info->discard_granularity =
+				min_t(unsigned int, erase_blks, MAX_PLIST_NUM);
+
+		if (erase_blks && BLKS_PER_SEC(sbi) % erase_blks)
+			f2fs_info(sbi, "section size (%u blocks) is not aligned to the device erase unit (%u blocks)",
+				  BLKS_PER_SEC(sbi), erase_blks);
 	}
 
 	sbi->readdir_ra = 1;
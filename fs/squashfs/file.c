@@ -39,6 +39,7 @@
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -495,6 +496,109 @@ static int squashfs_readpage(struct file *file, struct page *page)
 }
 
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/*
+ * Decompress a datablock whose pages the readahead code has all locked in
+ * the page cache straight into them.  Returns false if the block is not
+ * separately compressed or could not be read, the caller then falls back
+ * to reading the pages one at a time.
+ */
+static bool squashfs_readahead_block(struct inode *inode, struct page **page,
+	int pages, int index, int expected)
+{
+	struct squashfs_page_actor *actor;
+	int i, bsize, bytes, res;
+	u64 block = 0;
+	void *pageaddr;
+
+	bsize = read_blocklist(inode, index, &block);
+	if (bsize <= 0)
+		return false;
+
+	actor = squashfs_page_actor_init_special(page, pages, 0);
+	if (actor == NULL)
+		return false;
+
+	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+	kfree(actor);
+
+	if (res != expected)
+		return false;
+
+	/* Last page may have trailing bytes not filled */
+	bytes = res % PAGE_SIZE;
+	if (bytes) {
+		pageaddr = kmap_atomic(page[pages - 1]);
+		memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+		kunmap_atomic(pageaddr);
+	}
+
+	for (i = 0; i < pages; i++) {
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		put_page(page[i]);
+	}
+
+	return true;
+}
+
+/*
+ * Readahead hands us the whole window locked up front, which stops
+ * squashfs_readpage_block() from grabbing the neighbouring pages and forces
+ * it through the intermediate cache.  Instead walk the window a datablock at
+ * a time and decompress every block it fully covers directly into its pages.
+ */
+static void squashfs_readahead(struct readahead_control *ractl)
+{
+	struct inode *inode = ractl->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	int max_pages = 1 << shift;
+	int mask = max_pages - 1;
+	loff_t i_size = i_size_read(inode);
+	int file_end = i_size >> msblk->block_log;
+	pgoff_t next = readahead_index(ractl);
+	struct page **page;
+	int i, n;
+
+	page = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
+	if (page == NULL)
+		return;
+
+	while ((n = __readahead_batch(ractl, page,
+				      max_pages - (next & mask)))) {
+		int index = page[0]->index >> shift;
+		int expected = index == file_end ?
+				(i_size & (msblk->block_size - 1)) :
+				 msblk->block_size;
+		int pages = 0;
+
+		next = page[0]->index + n;
+
+		if (index < file_end)
+			pages = max_pages;
+		else if (squashfs_i(inode)->fragment_block ==
+						SQUASHFS_INVALID_BLK)
+			pages = DIV_ROUND_UP(expected, PAGE_SIZE);
+
+		if ((page[0]->index & mask) == 0 && n == pages &&
+		    squashfs_readahead_block(inode, page, n, index, expected))
+			continue;
+
+		for (i = 0; i < n; i++) {
+			squashfs_readpage(ractl->file, page[i]);
+			put_page(page[i]);
+		}
+	}
+
+	kfree(page);
+}
+#endif
+
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readahead = squashfs_readahead,
+#endif
 };
@@ -411,6 +411,10 @@ static inline void spi_unregister_driver(struct spi_driver *sdrv)
  *	     This field is optional and should only be implemented if the
  *	     controller has native support for memory like operations.
  * @unprepare_message: undo any work done by prepare_message().
+ * @optimize_message: optional, set up per-message state that stays valid
+ *	for as long as the message is pre-optimized, e.g. splitting transfers.
+ *	Only called for messages passed to spi_optimize_message().
+ * @unoptimize_message: undo any work done by optimize_message().
  * @slave_abort: abort the ongoing transfer request on an SPI slave controller
  * @cs_setup: delay to be introduced by the controller after CS is asserted
  * @cs_hold: delay to be introduced by the controller before CS is deasserted
@@ -619,6 +623,10 @@ struct spi_controller {
 			       struct spi_message *message);
 	int (*unprepare_message)(struct spi_controller *ctlr,
 				 struct spi_message *message);
+	int (*optimize_message)(struct spi_controller *ctlr,
+				struct spi_message *message);
+	void (*unoptimize_message)(struct spi_controller *ctlr,
+				   struct spi_message *message);
 	int (*slave_abort)(struct spi_controller *ctlr);
 
 	/*
@@ -972,6 +980,9 @@ struct spi_transfer {
  * @spi: SPI device to which the transaction is queued
  * @is_dma_mapped: if true, the caller provided both dma and cpu virtual
  *	addresses for each transfer buffer
+ * @pre_optimized: the message was validated and optimized once by
+ *	spi_optimize_message() and may be submitted repeatedly without
+ *	repeating that work
  * @complete: called to report transaction completions
  * @context: the argument to complete() when it's called
  * @frame_length: the total number of bytes in the message
@@ -981,6 +992,8 @@ struct spi_transfer {
  * @queue: for use by whichever driver currently owns the message
  * @state: for use by whichever driver currently owns the message
  * @resources: for resource management when the spi message is processed
+ * @opt_state: for use by the controller driver between optimize_message()
+ *	and unoptimize_message()
  *
  * A @spi_message is used to execute an atomic sequence of data transfers,
  * each represented by a struct spi_transfer.  The sequence is "atomic"
@@ -1002,6 +1015,7 @@ struct spi_message {
 	struct spi_device	*spi;
 
 	unsigned		is_dma_mapped:1;
+	unsigned		pre_optimized:1;
 
 	/* REVISIT:  we might want a flag affecting the behavior of the
 	 * last transfer ... allowing things like "read 16 bit length L"
@@ -1030,6 +1044,8 @@ struct spi_message {
 
 	/* list of spi_res reources when the spi message is processed */
 	struct list_head        resources;
+
+	void			*opt_state;
 };
 
 static inline void spi_message_init_no_memset(struct spi_message *m)
@@ -1123,6 +1139,9 @@ extern int spi_set_cs_timing(struct spi_device *spi,
 			     struct spi_delay *inactive);
 
 extern int spi_setup(struct spi_device *spi);
+extern int spi_optimize_message(struct spi_device *spi,
+				struct spi_message *msg);
+extern void spi_unoptimize_message(struct spi_message *msg);
 extern int spi_async(struct spi_device *spi, struct spi_message *message);
 extern int spi_async_locked(struct spi_device *spi,
 			    struct spi_message *message);
@@ -35,6 +35,23 @@ struct rpi_firmware_property_tag_header {
 	u32 req_resp_size;
 };
 
+/**
+ * struct rpi_firmware_async_tag - Firmware property tag queued for batching
+ * @tag:	One of enum_mbox_property_tag.
+ * @data:	Tag value buffer, overwritten with the firmware's response.
+ * @buf_size:	Size of @data in bytes, a multiple of 4.
+ * @complete:	Called from process context once the tag has been answered,
+ *		with 0 or a negative error code.
+ * @node:	Private to the firmware driver.
+ */
+struct rpi_firmware_async_tag {
+	u32 tag;
+	void *data;
+	size_t buf_size;
+	void (*complete)(struct rpi_firmware_async_tag *req, int ret);
+	struct list_head node;
+};
+
 enum rpi_firmware_property_tag {
 	RPI_FIRMWARE_PROPERTY_END =                           0,
 	RPI_FIRMWARE_GET_FIRMWARE_REVISION =                  0x00000001,
@@ -167,6 +184,8 @@ int rpi_firmware_property(struct rpi_firmware *fw,
 			  u32 tag, void *data, size_t len);
 int rpi_firmware_property_list(struct rpi_firmware *fw,
 			       void *data, size_t tag_size);
+int rpi_firmware_property_queue(struct rpi_firmware *fw,
+				struct rpi_firmware_async_tag *req);
 struct rpi_firmware *rpi_firmware_get(struct device_node *firmware_node);
 #else
 static inline int rpi_firmware_property(struct rpi_firmware *fw, u32 tag,
@@ -181,6 +200,12 @@ static inline int rpi_firmware_property_list(struct rpi_firmware *fw,
 	return -ENOSYS;
 }
 
+static inline int rpi_firmware_property_queue(struct rpi_firmware *fw,
+					      struct rpi_firmware_async_tag *req)
+{
+	return -ENOSYS;
+}
+
 static inline struct rpi_firmware *rpi_firmware_get(struct device_node *firmware_node)
 {
 	return NULL;
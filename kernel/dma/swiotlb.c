@@ -33,6 +33,7 @@
 #include <linux/ctype.h>
 #include <linux/highmem.h>
 #include <linux/gfp.h>
+#include <linux/log2.h>
 #include <linux/scatterlist.h>
 #include <linux/mem_encrypt.h>
 #include <linux/set_memory.h>
@@ -78,16 +79,30 @@ phys_addr_t io_tlb_start, io_tlb_end;
 static unsigned long io_tlb_nslabs;
 
 /*
- * The number of used IO TLB block
+ * The slabs are split into areas, each a whole number of IO_TLB_SEGSIZE
+ * segments with its own lock, so that CPUs bouncing at the same time
+ * normally search and update different parts of io_tlb_list. A mapping
+ * starts in the area picked by the current CPU and falls back to the
+ * others when that area is full.
  */
-static unsigned long io_tlb_used;
+#define IO_TLB_MAX_AREAS	16
+
+struct io_tlb_area {
+	spinlock_t lock;
+	unsigned int index;	/* slot to start the next search at */
+	unsigned long used;	/* number of used IO TLB blocks */
+	unsigned long bounced;	/* number of buffers bounced since boot */
+} ____cacheline_aligned_in_smp;
+
+static struct io_tlb_area io_tlb_areas[IO_TLB_MAX_AREAS];
+static unsigned int io_tlb_nareas = 1;	/* always a power of two */
+static unsigned long io_tlb_area_nslabs;
 
 /*
  * This is a free list describing the number of free entries available from
  * each index
  */
 static unsigned int *io_tlb_list;
-static unsigned int io_tlb_index;
 
 /*
  * Max segment that we can provide which (if pages are contingous) will
@@ -102,11 +117,6 @@ static unsigned int max_segment;
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 static phys_addr_t *io_tlb_orig_addr;
 
-/*
- * Protect the above data structures in the map and unmap calls
- */
-static DEFINE_SPINLOCK(io_tlb_lock);
-
 static int late_alloc;
 
 static int __init
@@ -196,6 +206,42 @@ void __init swiotlb_update_mem_attributes(void)
 	memset(vaddr, 0, bytes);
 }
 
+static unsigned long swiotlb_area_start(unsigned int area)
+{
+	return area * io_tlb_area_nslabs;
+}
+
+/* the last area also takes the slabs left over by the division */
+static unsigned long swiotlb_area_end(unsigned int area)
+{
+	if (area == io_tlb_nareas - 1)
+		return io_tlb_nslabs;
+	return (area + 1) * io_tlb_area_nslabs;
+}
+
+static void swiotlb_init_areas(void)
+{
+	unsigned int i, nareas;
+
+	nareas = min_t(unsigned int, roundup_pow_of_two(num_possible_cpus()),
+		       IO_TLB_MAX_AREAS);
+	while (nareas > 1 && io_tlb_nslabs / nareas < IO_TLB_SEGSIZE)
+		nareas >>= 1;
+
+	io_tlb_nareas = nareas;
+	if (nareas == 1)
+		io_tlb_area_nslabs = io_tlb_nslabs;
+	else
+		io_tlb_area_nslabs = ALIGN_DOWN(io_tlb_nslabs / nareas,
+						IO_TLB_SEGSIZE);
+
+	for (i = 0; i < nareas; i++) {
+		spin_lock_init(&io_tlb_areas[i].lock);
+		io_tlb_areas[i].index = swiotlb_area_start(i);
+		io_tlb_areas[i].used = 0;
+	}
+}
+
 int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 {
 	unsigned long i, bytes;
@@ -228,7 +274,7 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 	no_iotlb_memory = false;
 
 	if (verbose)
@@ -362,7 +408,7 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 	no_iotlb_memory = false;
 
 	swiotlb_print_info();
@@ -445,19 +491,97 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	}
 }
 
+/*
+ * Find nslots contiguous free slots in one area and mark them used.
+ * Returns the index of the first slot, or -1 if the area has no room.
+ */
+static int swiotlb_area_find_slots(unsigned int area_index,
+				   unsigned int nslots, unsigned int stride,
+				   unsigned long offset_slots,
+				   unsigned long max_slots)
+{
+	struct io_tlb_area *area = &io_tlb_areas[area_index];
+	unsigned long start = swiotlb_area_start(area_index);
+	unsigned long end = swiotlb_area_end(area_index);
+	unsigned int index, wrap;
+	unsigned long flags;
+	int i, count;
+
+	spin_lock_irqsave(&area->lock, flags);
+
+	if (unlikely(nslots > end - start - area->used))
+		goto not_found;
+
+	index = start + ALIGN(area->index - start, stride);
+	if (index >= end)
+		index = start;
+	wrap = index;
+
+	do {
+		while (iommu_is_span_boundary(index, nslots, offset_slots,
+					      max_slots)) {
+			index += stride;
+			if (index >= end)
+				index = start;
+			if (index == wrap)
+				goto not_found;
+		}
+
+		/*
+		 * If we find a slot that indicates we have 'nslots' number of
+		 * contiguous buffers, we allocate the buffers from that slot
+		 * and mark the entries as '0' indicating unavailable.
+		 */
+		if (io_tlb_list[index] >= nslots) {
+			count = 0;
+			for (i = index; i < (int) (index + nslots); i++)
+				io_tlb_list[i] = 0;
+			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
+				io_tlb_list[i] = ++count;
+
+			/*
+			 * Update the indices to avoid searching in the next
+			 * round.
+			 */
+			area->index = index + nslots < end ?
+				      index + nslots : start;
+			area->used += nslots;
+			area->bounced++;
+			spin_unlock_irqrestore(&area->lock, flags);
+			return index;
+		}
+		index += stride;
+		if (index >= end)
+			index = start;
+	} while (index != wrap);
+
+not_found:
+	spin_unlock_irqrestore(&area->lock, flags);
+	return -1;
+}
+
+static unsigned long swiotlb_used(void)
+{
+	unsigned long used = 0;
+	unsigned int i;
+
+	for (i = 0; i < io_tlb_nareas; i++)
+		used += READ_ONCE(io_tlb_areas[i].used);
+
+	return used;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *hwdev, phys_addr_t orig_addr,
 		size_t mapping_size, size_t alloc_size,
 		enum dma_data_direction dir, unsigned long attrs)
 {
 	dma_addr_t tbl_dma_addr = phys_to_dma_unencrypted(hwdev, io_tlb_start);
-	unsigned long flags;
 	phys_addr_t tlb_addr;
-	unsigned int nslots, stride, index, wrap;
-	int i;
+	unsigned int nslots, stride, start_area, i;
+	int index;
 	unsigned long mask;
 	unsigned long offset_slots;
 	unsigned long max_slots;
-	unsigned long tmp_io_tlb_used;
 
 	if (no_iotlb_memory)
 		panic("Can not allocate SWIOTLB buffer earlier and can't now provide you with the DMA bounce buffer");
@@ -498,67 +622,25 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev, phys_addr_t orig_addr,
 
 	/*
 	 * Find suitable number of IO TLB entries size that will fit this
-	 * request and allocate a buffer from that IO TLB pool.
+	 * request and allocate a buffer from that IO TLB pool, trying this
+	 * CPU's area first.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
-
-	if (unlikely(nslots > io_tlb_nslabs - io_tlb_used))
-		goto not_found;
-
-	index = ALIGN(io_tlb_index, stride);
-	if (index >= io_tlb_nslabs)
-		index = 0;
-	wrap = index;
-
-	do {
-		while (iommu_is_span_boundary(index, nslots, offset_slots,
-					      max_slots)) {
-			index += stride;
-			if (index >= io_tlb_nslabs)
-				index = 0;
-			if (index == wrap)
-				goto not_found;
-		}
-
-		/*
-		 * If we find a slot that indicates we have 'nslots' number of
-		 * contiguous buffers, we allocate the buffers from that slot
-		 * and mark the entries as '0' indicating unavailable.
-		 */
-		if (io_tlb_list[index] >= nslots) {
-			int count = 0;
-
-			for (i = index; i < (int) (index + nslots); i++)
-				io_tlb_list[i] = 0;
-			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
-				io_tlb_list[i] = ++count;
-			tlb_addr = io_tlb_start + (index << IO_TLB_SHIFT);
-
-			/*
-			 * Update the indices to avoid searching in the next
-			 * round.
-			 */
-			io_tlb_index = ((index + nslots) < io_tlb_nslabs
-					? (index + nslots) : 0);
-
+	start_area = raw_smp_processor_id() & (io_tlb_nareas - 1);
+	for (i = 0; i < io_tlb_nareas; i++) {
+		index = swiotlb_area_find_slots((start_area + i) &
+						(io_tlb_nareas - 1),
+						nslots, stride, offset_slots,
+						max_slots);
+		if (index >= 0)
 			goto found;
-		}
-		index += stride;
-		if (index >= io_tlb_nslabs)
-			index = 0;
-	} while (index != wrap);
-
-not_found:
-	tmp_io_tlb_used = io_tlb_used;
+	}
 
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
 	if (!(attrs & DMA_ATTR_NO_WARN) && printk_ratelimit())
 		dev_warn(hwdev, "swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-			 alloc_size, io_tlb_nslabs, tmp_io_tlb_used);
+			 alloc_size, io_tlb_nslabs, swiotlb_used());
 	return (phys_addr_t)DMA_MAPPING_ERROR;
 found:
-	io_tlb_used += nslots;
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	tlb_addr = io_tlb_start + ((phys_addr_t)index << IO_TLB_SHIFT);
 
 	/*
 	 * Save away the mapping from the original address to the DMA address.
@@ -585,6 +667,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	int i, count, nslots = ALIGN(alloc_size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
 	int index = (tlb_addr - io_tlb_start) >> IO_TLB_SHIFT;
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
+	struct io_tlb_area *area;
 
 	/*
 	 * First, sync the memory before unmapping the entry
@@ -600,7 +683,9 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	area = &io_tlb_areas[min_t(unsigned long, index / io_tlb_area_nslabs,
+				   io_tlb_nareas - 1)];
+	spin_lock_irqsave(&area->lock, flags);
 	{
 		count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
 			 io_tlb_list[index + nslots] : 0);
@@ -619,9 +704,9 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 		for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
 			io_tlb_list[i] = ++count;
 
-		io_tlb_used -= nslots;
+		area->used -= nslots;
 	}
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 }
 
 void swiotlb_tbl_sync_single(struct device *hwdev, phys_addr_t tlb_addr,
@@ -705,13 +790,36 @@ bool is_swiotlb_active(void)
 
 #ifdef CONFIG_DEBUG_FS
 
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = swiotlb_used();
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
+
+static int io_tlb_bounced_get(void *data, u64 *val)
+{
+	unsigned int i;
+
+	*val = 0;
+	for (i = 0; i < io_tlb_nareas; i++)
+		*val += READ_ONCE(io_tlb_areas[i].bounced);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_bounced, io_tlb_bounced_get, NULL,
+			 "%llu\n");
+
 static int __init swiotlb_create_debugfs(void)
 {
 	struct dentry *root;
 
 	root = debugfs_create_dir("swiotlb", NULL);
 	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, root, &io_tlb_used);
+	debugfs_create_file_unsafe("io_tlb_used", 0400, root, NULL,
+				   &fops_io_tlb_used);
+	debugfs_create_file_unsafe("io_tlb_bounced", 0400, root, NULL,
+				   &fops_io_tlb_bounced);
+	debugfs_create_u32("io_tlb_nareas", 0400, root, &io_tlb_nareas);
 	return 0;
 }
 
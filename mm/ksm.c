@@ -272,6 +272,17 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/*
+ * Whether ksmd adapts pages_to_scan to the merge rate it achieved over
+ * the last full scan, and the largest batch it may pick by itself.
+ */
+static bool ksm_auto_scan;
+static unsigned int ksm_auto_scan_max_pages = 4000;
+
+/* Progress of the current full scan, for the auto scan-rate tuning */
+static unsigned long ksm_pass_scanned;
+static unsigned long ksm_pass_merged;
+
 /* Checksum of an empty (zeroed) page */
 static unsigned int zero_checksum __read_mostly;
 
@@ -388,6 +399,7 @@ static inline struct rmap_item *alloc_rmap_item(void)
 static inline void free_rmap_item(struct rmap_item *rmap_item)
 {
 	ksm_rmap_items--;
+	rmap_item->mm->ksm_rmap_items--;
 	rmap_item->mm = NULL;	/* debug safety */
 	kmem_cache_free(rmap_item_cache, rmap_item);
 }
@@ -641,6 +653,9 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+
+		rmap_item->mm->ksm_merging_pages--;
+
 		VM_BUG_ON(stable_node->rmap_hlist_len <= 0);
 		stable_node->rmap_hlist_len--;
 		put_anon_vma(rmap_item->anon_vma);
@@ -790,6 +805,9 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+
+		rmap_item->mm->ksm_merging_pages--;
+
 		VM_BUG_ON(stable_node->rmap_hlist_len <= 0);
 		stable_node->rmap_hlist_len--;
 
@@ -2022,6 +2040,8 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_sharing++;
 	else
 		ksm_pages_shared++;
+
+	rmap_item->mm->ksm_merging_pages++;
 }
 
 /*
@@ -2215,6 +2235,7 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	if (rmap_item) {
 		/* It has already been zeroed */
 		rmap_item->mm = mm_slot->mm;
+		rmap_item->mm->ksm_rmap_items++;
 		rmap_item->address = addr;
 		rmap_item->rmap_list = *rmap_list;
 		*rmap_list = rmap_item;
@@ -2381,12 +2402,53 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 	return NULL;
 }
 
+/*
+ * A full scan that merged at least one page per KSM_AUTO_SCAN_HIT_HIGH
+ * scanned doubles the batch size, one that merged less than one page per
+ * KSM_AUTO_SCAN_HIT_LOW halves it again, down to KSM_AUTO_SCAN_MIN_PAGES.
+ * Identical containers converge quickly this way, and ksmd backs off once
+ * there is nothing left to gain.
+ */
+#define KSM_AUTO_SCAN_HIT_HIGH	32
+#define KSM_AUTO_SCAN_HIT_LOW	1024
+#define KSM_AUTO_SCAN_MIN_PAGES	100
+
+static void ksm_auto_scan_tune(void)
+{
+	unsigned long merged = ksm_pages_shared + ksm_pages_sharing;
+	unsigned long scanned = ksm_pass_scanned;
+	unsigned long gained = 0;
+	unsigned int pages, max_pages;
+
+	if (merged > ksm_pass_merged)
+		gained = merged - ksm_pass_merged;
+	ksm_pass_merged = merged;
+	ksm_pass_scanned = 0;
+
+	if (!READ_ONCE(ksm_auto_scan) || !scanned)
+		return;
+
+	pages = READ_ONCE(ksm_thread_pages_to_scan);
+	max_pages = max_t(unsigned int, READ_ONCE(ksm_auto_scan_max_pages),
+			  KSM_AUTO_SCAN_MIN_PAGES);
+
+	if (gained * KSM_AUTO_SCAN_HIT_HIGH >= scanned)
+		pages = min_t(unsigned long, (unsigned long)pages * 2,
+			      max_pages);
+	else if (gained * KSM_AUTO_SCAN_HIT_LOW < scanned)
+		pages = max_t(unsigned int, pages / 2,
+			      KSM_AUTO_SCAN_MIN_PAGES);
+
+	WRITE_ONCE(ksm_thread_pages_to_scan, pages);
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages:  number of pages we want to scan before we return.
  */
 static void ksm_do_scan(unsigned int scan_npages)
 {
+	unsigned long seqnr = ksm_scan.seqnr;
 	struct rmap_item *rmap_item;
 	struct page *page;
 
@@ -2394,10 +2456,14 @@ static void ksm_do_scan(unsigned int scan_npages)
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
-			return;
+			break;
 		cmp_and_merge_page(page, rmap_item);
 		put_page(page);
+		ksm_pass_scanned++;
 	}
+
+	if (ksm_scan.seqnr != seqnr)
+		ksm_auto_scan_tune();
 }
 
 static int ksmd_should_run(void)
@@ -3005,6 +3071,52 @@ static ssize_t use_zero_pages_store(struct kobject *kobj,
 }
 KSM_ATTR(use_zero_pages);
 
+static ssize_t auto_scan_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_auto_scan);
+}
+
+static ssize_t auto_scan_store(struct kobject *kobj,
+			       struct kobj_attribute *attr,
+			       const char *buf, size_t count)
+{
+	int err;
+	bool value;
+
+	err = kstrtobool(buf, &value);
+	if (err)
+		return -EINVAL;
+
+	ksm_auto_scan = value;
+
+	return count;
+}
+KSM_ATTR(auto_scan);
+
+static ssize_t auto_scan_max_pages_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_auto_scan_max_pages);
+}
+
+static ssize_t auto_scan_max_pages_store(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 const char *buf, size_t count)
+{
+	int err;
+	unsigned long nr_pages;
+
+	err = kstrtoul(buf, 10, &nr_pages);
+	if (err || nr_pages > UINT_MAX)
+		return -EINVAL;
+
+	ksm_auto_scan_max_pages = nr_pages;
+
+	return count;
+}
+KSM_ATTR(auto_scan_max_pages);
+
 static ssize_t max_page_sharing_show(struct kobject *kobj,
 				     struct kobj_attribute *attr, char *buf)
 {
@@ -3148,6 +3260,8 @@ static struct attribute *ksm_attrs[] = {
 	&stable_node_dups_attr.attr,
 	&stable_node_chains_prune_millisecs_attr.attr,
 	&use_zero_pages_attr.attr,
+	&auto_scan_attr.attr,
+	&auto_scan_max_pages_attr.attr,
 	NULL,
 };
 
@@ -2475,6 +2475,21 @@ bool skb_page_frag_refill(unsigned int sz, struct page_frag *pfrag, gfp_t gfp)
 }
 EXPORT_SYMBOL(skb_page_frag_refill);
 
+/* Every skb carved out of a 32KB frag holds a reference on the whole
+ * compound page, so on small machines a few skbs lingering in socket
+ * queues pin far more memory than they are charged for. Default to
+ * order-0 frags there; net.core.high_order_alloc_disable still allows
+ * overriding this.
+ */
+static int __init skb_page_frag_order_init(void)
+{
+	if (totalram_pages() < (1UL << (30 - PAGE_SHIFT)))
+		static_branch_enable(&net_high_order_alloc_disable_key);
+
+	return 0;
+}
+core_initcall(skb_page_frag_order_init);
+
 bool sk_page_frag_refill(struct sock *sk, struct page_frag *pfrag)
 {
 	if (likely(skb_page_frag_refill(32U, pfrag, sk->sk_allocation)))
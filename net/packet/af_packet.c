@@ -88,6 +88,7 @@
 #endif
 #include <linux/bpf.h>
 #include <net/compat.h>
+#include <net/busy_poll.h>
 
 #include "internal.h"
 
@@ -2136,6 +2137,8 @@ static int packet_rcv(struct sk_buff *skb, struct net_device *dev,
 	/* drop conntrack reference */
 	nf_reset_ct(skb);
 
+	sk_mark_napi_id(sk, skb);
+
 	spin_lock(&sk->sk_receive_queue.lock);
 	po->stats.stats1.tp_packets++;
 	sock_skb_set_dropcount(sk, skb);
@@ -2321,6 +2324,9 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	}
 	spin_unlock(&sk->sk_receive_queue.lock);
 
+	/* Let poll() on a ring socket busy poll the device it is fed by */
+	sk_mark_napi_id(sk, skb);
+
 	skb_copy_bits(skb, 0, h.raw + macoff, snaplen);
 
 	if (!(ts_status = tpacket_get_timestamp(skb, &ts, po->tp_tstamp)))
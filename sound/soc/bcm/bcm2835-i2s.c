@@ -695,6 +695,13 @@ static int bcm2835_i2s_startup(struct snd_pcm_substream *substream,
 {
 	struct bcm2835_i2s_dev *dev = snd_soc_dai_get_drvdata(dai);
 
+	/*
+	 * bcm2835-dma only raises the period interrupt when asked to and
+	 * reports the residue with burst granularity, so timer-scheduled
+	 * clients can run without period wakeups.
+	 */
+	substream->runtime->hw.info |= SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
+
 	if (snd_soc_dai_active(dai))
 		return 0;
 
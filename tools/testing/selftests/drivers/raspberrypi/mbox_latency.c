@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Round-trip latency of the VideoCore firmware property mailbox, measured
+ * through /dev/vcio with a GET_FIRMWARE_REVISION request, the cheapest
+ * call the firmware answers.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+
+#include "../../kselftest.h"
+
+#define TEST_PREFIX	"drivers/raspberrypi/mbox_latency"
+
+#define VCIO_IOC_MAGIC		100
+#define IOCTL_MBOX_PROPERTY	_IOWR(VCIO_IOC_MAGIC, 0, char *)
+
+#define RPI_FIRMWARE_STATUS_REQUEST		0
+#define RPI_FIRMWARE_GET_FIRMWARE_REVISION	0x00000001
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int get_firmware_revision(int fd)
+{
+	uint32_t buf[7] __attribute__((aligned(16)));
+
+	buf[0] = sizeof(buf);
+	buf[1] = RPI_FIRMWARE_STATUS_REQUEST;
+	buf[2] = RPI_FIRMWARE_GET_FIRMWARE_REVISION;
+	buf[3] = sizeof(uint32_t);	/* value buffer size */
+	buf[4] = 0;			/* request code */
+	buf[5] = 0;			/* value */
+	buf[6] = 0;			/* end tag */
+
+	return ioctl(fd, IOCTL_MBOX_PROPERTY, buf);
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t start, delta, total = 0, min = UINT64_MAX, max = 0;
+	int iterations = 1000;
+	int fd, i;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+	if (iterations <= 0) {
+		fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+		exit(1);
+	}
+
+	fd = open("/dev/vcio", O_RDWR);
+	if (fd < 0) {
+		printf("%s: [skip,no-vcio]\n", TEST_PREFIX);
+		exit(KSFT_SKIP);
+	}
+
+	for (i = 0; i < iterations; i++) {
+		start = now_ns();
+		if (get_firmware_revision(fd)) {
+			printf("%s: [FAIL,ioctl: %s]\n", TEST_PREFIX,
+			       strerror(errno));
+			exit(1);
+		}
+		delta = now_ns() - start;
+
+		total += delta;
+		if (delta < min)
+			min = delta;
+		if (delta > max)
+			max = delta;
+	}
+
+	printf("mbox_roundtrip_iterations=%d\n", iterations);
+	printf("mbox_roundtrip_avg_us=%.1f\n", total / 1000.0 / iterations);
+	printf("mbox_roundtrip_min_us=%.1f\n", min / 1000.0);
+	printf("mbox_roundtrip_max_us=%.1f\n", max / 1000.0);
+	printf("%s: ok\n", TEST_PREFIX);
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,151 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Throughput/latency numbers for Raspberry Pi I/O hot paths, printed as
+# key=value lines so that runs on different kernels can be diffed or
+# checked against thresholds by a CI job.
+#
+# Each section is skipped when its hardware or tool is missing:
+#   mailbox  - /dev/vcio (mbox_latency)
+#   dma      - memcpy on a free bcm2835-dma channel through the dmatest
+#              module
+#   block    - RPI_BENCH_BLKDEV=/dev/mmcblk0 (or similar) must be set;
+#              sequential read with dd, 4k random read IOPS with fio
+#
+# The SD card is only ever read, never written.
+
+ksft_skip=4
+ret=0
+ran=0
+
+dmesg_since()
+{
+	dmesg | tail -n +"$(( $1 + 1 ))"
+}
+
+bench_mailbox()
+{
+	if [ ! -c /dev/vcio ]; then
+		echo "mailbox: skip (no /dev/vcio)"
+		return
+	fi
+
+	if ./mbox_latency 1000; then
+		ran=1
+	else
+		echo "mailbox: FAIL"
+		ret=1
+	fi
+}
+
+# Without a usable bcm2835-dma channel there is nothing to measure on this
+# platform: report a skip, unless an earlier section already failed.
+# bench_dma runs last so that this does not cut other sections short.
+skip_dma()
+{
+	echo "dma: SKIP ($1)"
+	[ $ret = 0 ] || exit $ret
+	exit $ksft_skip
+}
+
+# Print the first free bcm2835-dma channel, e.g. "dma0chan4"
+bcm2835_dma_chan()
+{
+	for c in /sys/class/dma/dma*chan*; do
+		[ -e "$c" ] || continue
+		[ "$(cat "$c/in_use" 2>/dev/null)" = 0 ] || continue
+		drv=$(readlink -f "$c/device/driver" 2>/dev/null)
+		if [ "${drv##*/}" = bcm2835-dma ]; then
+			echo "${c##*/}"
+			return
+		fi
+	done
+}
+
+bench_dma()
+{
+	params=/sys/module/dmatest/parameters
+
+	if ! modprobe -q dmatest 2>/dev/null && [ ! -d $params ]; then
+		skip_dma "no dmatest module"
+	fi
+
+	chan=$(bcm2835_dma_chan)
+	if [ -z "$chan" ]; then
+		skip_dma "no free bcm2835-dma channel"
+	fi
+
+	start=$(dmesg | wc -l)
+
+	echo 2000 > $params/timeout
+	echo 200 > $params/iterations
+	echo 65536 > $params/test_buf_size
+	echo 1 > $params/threads_per_chan
+	echo 1 > $params/max_channels
+	echo 0 > $params/noverify
+	# dmatest refuses channels that cannot do memcpy
+	if ! echo "$chan" > $params/channel 2>/dev/null; then
+		skip_dma "$chan has no memcpy capability"
+	fi
+	echo 1 > $params/run
+	cat $params/wait > /dev/null
+
+	# dmatest: dma0chan0-copy0: summary 200 tests, 0 failures \
+	#          1234.56 iops 39506 KB/s (0)
+	summary=$(dmesg_since "$start" |
+		  grep -m1 "dmatest: $chan-copy[0-9]*: summary")
+	if [ -z "$summary" ]; then
+		skip_dma "no dmatest summary for $chan"
+	fi
+
+	failures=$(echo "$summary" | sed -n 's/.* \([0-9]*\) failures.*/\1/p')
+	iops=$(echo "$summary" | sed -n 's/.* \([0-9.]*\) iops.*/\1/p')
+	kbps=$(echo "$summary" | sed -n 's/.* \([0-9]*\) KB\/s.*/\1/p')
+
+	echo "dma_memcpy_64k_iops=$iops"
+	echo "dma_memcpy_64k_kbps=$kbps"
+	echo "dma_memcpy_failures=$failures"
+	ran=1
+	[ "$failures" = "0" ] || ret=1
+}
+
+bench_block()
+{
+	dev="$RPI_BENCH_BLKDEV"
+
+	if [ -z "$dev" ] || [ ! -b "$dev" ]; then
+		echo "block: skip (RPI_BENCH_BLKDEV not set)"
+		return
+	fi
+
+	# dd reports "... copied, 2.1 s, 30.5 MB/s" on its last line
+	rate=$(dd if="$dev" of=/dev/null bs=1M count=64 iflag=direct 2>&1 |
+	       tail -n 1 | sed -n 's/.*, \([0-9.]* [kMG]*B\/s\)$/\1/p')
+	echo "block_seq_read=$rate"
+	ran=1
+
+	if ! command -v fio > /dev/null; then
+		echo "block_randread: skip (no fio)"
+		return
+	fi
+
+	# terse output: field 8 is the read IOPS
+	iops=$(fio --name=randread --filename="$dev" --readonly --rw=randread \
+		   --bs=4k --direct=1 --ioengine=psync --runtime=10 \
+		   --time_based --minimal | cut -d';' -f8)
+	echo "block_randread_4k_iops=$iops"
+}
+
+if [ "$(id -u)" != 0 ]; then
+	echo "rpi_io_bench: skip (must be run as root)"
+	exit $ksft_skip
+fi
+
+bench_mailbox
+bench_block
+bench_dma
+
+if [ $ran = 0 ]; then
+	exit $ksft_skip
+fi
+exit $ret